@@ -0,0 +1,56 @@
+// Macro to consolidate the per-run qa.root files into one cache file for the EMCal QA plotting macros
+
+/*
+   MACRO OVERVIEW:
+   Reads every run of the catalog from <inputDir>/<run>/qa.root, one file at a time, and writes all QA
+   histograms together with each run's event count and SEB count into a single consolidated cache file
+   (see RunHistCache::Consolidate for the layout). SinglePlotGenerator and OverlayedPlotGenerator pick the
+   file up automatically when it sits at <inputDir>/qa_consolidated.root, so regenerating every plot costs
+   one open and one read instead of one per run.
+   The runs are selected exactly like the plotters select them (CSV or run database, run range, good runs)
+   and the input is opened with the same timeout and retry settings, so the file covers the same run set.
+
+   Usage: root -l -b -q 'ConsolidateQA.cpp("runs.csv")'
+*/
+
+#include <string>
+#include "QARunCache.h"
+#include "QARunCatalog.h"
+#include "QARunFetch.h"
+
+// Struct to hold every setting of a consolidation pass
+struct ConsolidateConfig {
+    std::string runList;        // Optional CSV run catalog, empty for the default runs
+    int minRun = 0;             // Only runs from this run number on, 0 = no lower limit
+    int maxRun = 0;             // Only runs up to this run number, 0 = no upper limit
+    bool goodOnly = false;      // Only the runs flagged good in the catalog
+    std::string dbUrl;          // Run database (e.g. mysql://host/db) queried instead of runList, empty for none
+    std::string dbUser;         // Run database user
+    std::string dbPassword;     // Run database password
+    std::string dbQuery;        // Query returning run, sebCount and (optionally) a good-run flag
+    std::string inputDir;       // Directory or URL (root://...) holding <run>/qa.root, empty for the default
+    std::string outFile;        // Consolidated file to write, empty for <inputDir>/qa_consolidated.root
+    int openTimeout = 0;        // Seconds before an open of a (remote) qa.root gives up, 0 = no timeout
+    int openRetries = 0;        // Extra attempts at opening a qa.root that failed to open
+};
+
+// Write the consolidated cache file for the runs selected by config; returns the number of runs written
+int RunConsolidate(const ConsolidateConfig& config) {
+    RunCatalog catalog = RunCatalog::Load(config.runList, config.dbUrl, config.dbUser, config.dbPassword, config.dbQuery)
+        .Filter(config.minRun, config.maxRun, config.goodOnly);
+    ConfigureRunCache(config.inputDir, "", config.openTimeout, config.openRetries);
+    return RunHistCache::Instance().Consolidate(catalog, config.outFile);
+}
+
+// runList: optional CSV run catalog (default runs if empty); inputDir: directory holding <run>/qa.root (default if empty)
+// outFile: consolidated file to write, empty for <inputDir>/qa_consolidated.root
+// Database selection and run range are set through ConsolidateConfig and RunConsolidate()
+void ConsolidateQA(const char* runList = "", const char* inputDir = "", const char* outFile = "", int openTimeout = 0, int openRetries = 0) {
+    ConsolidateConfig config;
+    config.runList = runList ? runList : "";
+    config.inputDir = inputDir ? inputDir : "";
+    config.outFile = outFile ? outFile : "";
+    config.openTimeout = openTimeout;
+    config.openRetries = openRetries;
+    RunConsolidate(config);
+}
@@ -6,6 +6,11 @@
    The histograms are extracted from ROOT files corresponding to different runs.
    Once extracted, the histograms are overlaid onto a single canvas for comparison.
    The OverlayPlotter class manages the loading, overlaying, and display of these histograms.
+   Optionally every run is first scored against the mean of the good runs (see QACompare.h), and only
+   the overlays of histograms with flagged runs, or none at all, are drawn.
+   A lower ratio pad can show every run divided by a chosen run or by the average of the overlaid runs.
+   In watch mode (see WatchQA.cpp) AppendRuns() keeps one canvas per histogram between calls and only reads
+   and draws the new runs, optionally keeping just the latest curves on it.
 */
 
 #include <TFile.h>
@@ -14,20 +19,36 @@
 #include <TPaveText.h>
 #include <iostream>
 #include <vector>
+#include <deque>
+#include <map>
 #include <string>
-#include <unordered_map>
+#include <cstdio>
+#include <fstream>
+#include <chrono>
+#include <future>
 #include <TColor.h>
 #include <TLegend.h>
+#include <TLegendEntry.h>
+#include <TLatex.h>
+#include <TList.h>
+#include <TROOT.h>
+#include <ROOT/TProcessExecutor.hxx>
+#include "QARunCache.h"
+#include "QAHistSpec.h"
+#include "QARunCatalog.h"
+#include "QALogger.h"
+#include "QATiming.h"
+#include "QANormalization.h"
+#include "QAPlotWriter.h"
+#include "QARunFetch.h"
+#include "QACompare.h"
+#include "QARatio.h"
+#include "QARebin.h"
+#include "QAShard.h"
 
 class OverlayPlotter {
 public:
     
-    // Struct to hold run-specific data
-    struct RunData {
-        Color_t color;     // Color for this run's histogram
-        int sebCount;      // Count of Sub Event Buffers (SEBs) for each run
-    };
-    
     // Constructor to initialize canvas, legend, and other attributes
     OverlayPlotter(bool normalize) : normalize_(normalize) {
         // Initializing the canvas
@@ -36,124 +57,788 @@ public:
         cOverlay_->SetGrid();
         
         // Initializing the legend
-        leg_ = new TLegend(0.6, 0.6, 0.9, 0.9);
-        leg_->SetNColumns(2);
-        leg_->SetFillColorAlpha(0, 0.2);
-        leg_->SetBorderSize(1);
-        leg_->SetMargin(0.15);
-        leg_->SetTextSize(0.025);
-        
-        for (const auto& entry : runDataMap_) {
-            runNumbers_.push_back(entry.first);
+        leg_ = NewLegend();
+    }
+    
+    // Destructor: frees the histograms still on the canvas and the canvases kept by AppendRuns, then the legend and canvas themselves
+    ~OverlayPlotter() {
+        ResetCanvas();
+        for (auto& live : live_) {
+            for (auto& curve : live.second.curves) {
+                delete curve.second;
+            }
+            delete live.second.reference;
+            delete live.second.legend;
+            delete live.second.canvas;
         }
+        delete leg_;
+        delete cOverlay_;
+    }
+    
+    // Directory the overlay images are written to (with trailing '/')
+    void SetOutputDir(const std::string& outputDir) { outputDir_ = outputDir; }
+    const std::string& GetOutputDir() const { return outputDir_; }
+    
+    // Output file of the overlay for one histogram (and one group of runs, see SetGrouping)
+    std::string GetOutputFile(const std::string& histName, const std::string& groupLabel = "") const {
+        return outputDir_ + "Overlayed_" + histName + "_QA_October" + (groupLabel.empty() ? "" : "_" + groupLabel) + "." + writer_.GetFormat();
+    }
+    
+    // Multi-page document holding every group of one histogram, empty unless SetMultiPagePdf is on
+    std::string GetDocumentFile(const std::string& histName) const {
+        return writer_.IsMultiPage() ? outputDir_ + "Overlayed_" + histName + "_QA_October.pdf" : "";
+    }
+    
+    // Split the runs into canvases of at most maxGroupSize runs (0 = unbounded), grouped by SEB count or run range
+    // Runs of a group are colored from the current palette instead of their catalog colors
+    void SetGrouping(RunGrouping grouping, size_t maxGroupSize) {
+        grouping_ = grouping;
+        maxGroupSize_ = maxGroupSize;
+    }
+    
+    // Draw at most maxBins merged bins per run (0 = full resolution); comparisons still use every bin
+    void SetMaxDisplayBins(int maxBins) { maxDisplayBins_ = maxBins; }
+    
+    // Watch mode: keep only the curves of the latest maxRuns runs on each overlay (0 = every run of the session)
+    void SetMaxLiveRuns(size_t maxRuns) { maxLiveRuns_ = maxRuns; }
+    
+    // Put the groups of each histogram on the pages of one PDF instead of one file per group
+    void SetMultiPagePdf(bool multiPage) { writer_.SetMultiPage(multiPage); }
+    
+    // Image format of the overlays (png, pdf, svg, ...) and, for PNGs, the compression level (0-100, -1 = ROOT default)
+    void SetOutputFormat(const std::string& format, int pngCompression = -1) {
+        writer_.SetFormat(format);
+        writer_.SetPngCompression(pngCompression);
+    }
+    
+    // Compress PNGs on nEncoders background threads while the next overlay is drawn
+    void SetAsyncEncoding(bool async, unsigned nEncoders = 1) { writer_.SetAsyncEncoding(async, nEncoders); }
+    
+    // Set the runs to overlay with their SEB counts and colors, drawn in run order (defaults to RunCatalog::Default())
+    void SetRunCatalog(const RunCatalog& catalog) {
+        catalog_ = catalog;
+        catalog_.SortByRun();
+        norms_.Clear();
     }
     
     // Resetting the canvas and legend for a fresh plot
+    // The canvas and legend only reference the overlaid histograms, so they are detached first and then deleted
     void ResetCanvas() {
         cOverlay_->Clear();
         leg_->Clear();
+        for (TH1F* hist : overlayHists_) {
+            delete hist;
+        }
+        overlayHists_.clear();
+        for (TH1F* hist : fullResHists_) {
+            delete hist;
+        }
+        fullResHists_.clear();
+        drawnRuns_.clear();
+    }
+    
+    // Add a lower pad with each run divided by referenceRun (RatioReference::kRun) or by the average of the
+    // overlaid runs (RatioReference::kAverage), drawn between ratioMin and ratioMax; kNone removes the pad
+    void SetRatioPanel(RatioReference reference, const std::string& referenceRun = "", double ratioMin = 0.0, double ratioMax = 2.0) {
+        ratio_ = reference;
+        ratioRun_ = referenceRun;
+        ratioMin_ = ratioMin;
+        ratioMax_ = ratioMax;
+    }
+    
+    // Free each histogram type from the shared cache once its overlay is saved
+    // The plotter itself only ever holds the copies drawn on one canvas, but the first read of a run brings all of
+    // its QA histograms into the cache, so the cache peaks at every run's histograms during the first overlay.
+    // Releasing lowers the memory as the remaining overlays are drawn, not that peak; only a memory budget
+    // (RunHistCache::SetMemoryBudget, memoryBudgetMB in the config) bounds it.
+    void SetReleaseCachedHists(bool release) { releaseCachedHists_ = release; }
+    
+    // Console verbosity (quiet/info/debug)
+    void SetLogLevel(LogLevel level) { logLevel_ = level; }
+    
+    // Write a JSON-lines summary (run, histogram, status, nEvents, time) at the end of OverlayAll ("-" = standard output)
+    void SetSummaryFile(const std::string& summaryFile) { summaryFile_ = summaryFile; }
+    
+    // Record per-stage timings of every overlay and print a summary table at the end of OverlayAll
+    // csvPath (optional) additionally receives one line per run and histogram
+    void SetTiming(bool timing, const std::string& csvPath = "") {
+        timing_ = timing;
+        timingCsv_ = csvPath;
+    }
+    
+    // Prefetch mode: read the next run's qa.root on a background thread while the current run is drawn
+    void SetPrefetch(bool prefetch) { prefetch_ = prefetch; }
+    
+    // Score every run against the mean of the normalized good runs before drawing, and print the outliers
+    // render selects the overlays drawn afterwards: all of them, only the flagged runs (with the reference), or none
+    void SetComparison(bool compare, RenderMode render = RenderMode::kAll) {
+        compare_ = compare;
+        render_ = render;
+    }
+    
+    // Flag a run whose KS probability is below minKsProb or whose chi2/ndf is above maxChi2Ndf
+    void SetComparisonThresholds(double minKsProb, double maxChi2Ndf) { comparator_.SetThresholds(minKsProb, maxChi2Ndf); }
+    
+    // Write every run's scores to csvPath at the end of the comparison (empty = no file)
+    void SetComparisonFile(const std::string& csvPath) { comparisonCsv_ = csvPath; }
+    
+    // Scores and references of the last comparison
+    const RunComparator& GetComparator() const { return comparator_; }
+    
+    // Score every run of one histogram type against the reference of that type
+    // Two passes over the runs, first building the reference and then scoring, so only one copy is held at a time
+    void Compare(const std::string& histName) {
+        for (int pass = 0; pass < 2; pass++) {
+            for (const auto& info : catalog_) {
+                if (pass == 0 && !info.good) {
+                    continue;
+                }
+                TH1F* hist = NormalizedCopy(info, histName);
+                if (!hist) {
+                    if (pass == 1 && logLevel_ >= LogLevel::kDebug) {
+                        std::cout << "Not scored: run " << info.run << " " << histName << "\n";
+                    }
+                    continue;
+                }
+                if (pass == 0) {
+                    comparator_.AddReference(histName, hist, info.run);
+                } else {
+                    comparator_.Score(info.run, histName, hist);
+                }
+                delete hist;
+            }
+            if (pass == 0) {
+                comparator_.FinishReference(histName);
+                if (logLevel_ >= LogLevel::kInfo) {
+                    std::cout << "Reference for " << histName << ": mean of " << comparator_.ReferenceSize(histName) << " good runs\n";
+                }
+            }
+        }
+        
+        // Nothing more will be read of a type that is not going to be drawn
+        if (releaseCachedHists_ && !IsRendered(histName)) {
+            RunHistCache::Instance().ReleaseHist(histName);
+        }
+    }
+    
+    // Score every histogram type, then print the ranked outliers and write the scores
+    void CompareAll(const std::vector<HistSpec>& specs) {
+        comparator_.Clear();
+        for (const auto& spec : specs) {
+            Compare(spec.histName);
+        }
+        if (logLevel_ >= LogLevel::kInfo || comparator_.Scores().empty()) {
+            comparator_.PrintOutliers();
+        }
+        if (!comparisonCsv_.empty()) {
+            comparator_.WriteCSV(comparisonCsv_);
+        }
+    }
+    
+    // Whether the overlay of histName is drawn, given the comparison mode
+    bool IsRendered(const std::string& histName) const {
+        if (!compare_ || render_ == RenderMode::kAll) {
+            return true;
+        }
+        return render_ == RenderMode::kFlagged && comparator_.NFlagged(histName) > 0;
     }
     
     // Primary function to overlay histograms for all runs
+    // Each group of runs (see SetGrouping) gets its own canvas, saved as its own file or page; every run is drawn once
     void Overlay(const std::string& histName, const std::string& title, const std::string& xAxisTitle, const std::string& yAxisTitle) {
-        ResetCanvas();
+        // Background reads and encoders need ROOT's thread safety even though the overlay itself is drawn on this thread
+        if (prefetch_ || writer_.IsAsync()) {
+            ROOT::EnableThreadSafety();
+        }
+        
+        // Runs in drawing order across all groups, for prefetching the next one
+        const std::vector<RunGroup> groups = catalog_.Group(grouping_, maxGroupSize_);
+        std::vector<const RunInfo*> sequence;
+        for (const auto& group : groups) {
+            for (const auto& info : group.runs) {
+                sequence.push_back(&info);
+            }
+        }
+        
+        std::future<bool> prefetch;
+        size_t next = 0;
+        for (const auto& group : groups) {
+            ResetCanvas();
+            if (ratio_ != RatioReference::kNone) {
+                SplitCanvas();
+            }
+            const std::string groupTitle = group.label.empty() ? title : title + " (" + group.label + ")";
+            
+            // Loop over the runs of the group; each run's output is written to the console in one piece
+            for (const RunInfo& info : group.runs) {
+                FinishPrefetch(prefetch, info.run, Timing());
+                next++;
+                if (prefetch_ && next < sequence.size()) {
+                    prefetch = PrefetchRun(sequence[next]->run);
+                }
+                if (compare_ && render_ == RenderMode::kFlagged && !comparator_.IsFlagged(info.run, histName)) {
+                    summary_.Add({info.run, histName, "skipped", norms_.Get(info).nEvents, 0, ""});
+                    continue;
+                }
+                RunLog log(logLevel_);
+                auto start = std::chrono::steady_clock::now();
+                std::string error;
+                std::string status = OverlayRun(info, histName, groupTitle, xAxisTitle, yAxisTitle, log, error);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                summary_.Add({info.run, histName, status, norms_.Get(info).nEvents, ms, error});
+                log.Flush();
+            }
+            if (overlayHists_.empty()) {
+                continue;
+            }
+            
+            // Draw the reference the runs were scored against
+            if (compare_ && comparator_.GetReference(histName)) {
+                DrawReference(histName, true);
+            }
+            
+            // Drawing the legend and other labels
+            leg_->Draw();
+            TLatex sphenixLabel;
+            sphenixLabel.SetTextSize(0.03);
+            sphenixLabel.DrawLatexNDC(0.67, 0.575, "sPHENIX EMCal QA");
+            cOverlay_->SetTitle(groupTitle.c_str());
+            StageTimer timer;
+            if (ratio_ != RatioReference::kNone) {
+                DrawRatios(histName);
+            }
+            cOverlay_->Update();
+            StageRecord timing;
+            timing.run = group.label.empty() ? "*" : group.label;
+            timing.histName = histName;
+            timing.ms[kStageDraw] = timer.Lap();
+            writer_.Save(cOverlay_, GetOutputFile(histName, group.label), GetDocumentFile(histName));
+            timing.ms[kStageSave] = timer.Lap();
+            if (timing_) {
+                timingReport_.Add(timing);
+            }
+        }
+        writer_.ClosePages(cOverlay_);
+        
+        // The drawn copies stay on the canvas until the next ResetCanvas(); the cached originals can go now
+        if (releaseCachedHists_) {
+            RunHistCache::Instance().ReleaseHist(histName);
+        }
+    }
+    
+    // Watch mode: add runs to the overlays kept from the earlier calls and save every overlay again
+    // Each histogram keeps its own canvas and legend between calls; only the new runs are read, normalized and
+    // drawn onto it, and past the SetMaxLiveRuns window the oldest curves are taken off again. Grouping, the
+    // ratio pad and the render mode do not apply. With comparison on, the first call builds the reference from
+    // its good runs and every later run is scored against it.
+    void AppendRuns(const std::vector<RunInfo>& runs, const std::vector<HistSpec>& specs) {
+        if (runs.empty()) {
+            return;
+        }
+        summary_.Clear();
+        timingReport_.Clear();
+        for (const auto& info : runs) {
+            catalog_.Add(info);
+        }
+        for (const auto& spec : specs) {
+            if (compare_) {
+                ScoreNewRuns(runs, spec.histName);
+            }
+            
+            // Read, normalize and style the new curves, then take them over from the plotter
+            ResetCanvas();
+            for (const RunInfo& info : runs) {
+                RunLog log(logLevel_);
+                auto start = std::chrono::steady_clock::now();
+                std::string error;
+                std::string status = OverlayRun(info, spec.histName, spec.title, spec.xAxisTitle, spec.yAxisTitle, log, error, false);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                summary_.Add({info.run, spec.histName, status, norms_.Get(info).nEvents, ms, error});
+                log.Flush();
+            }
+            std::vector<std::pair<std::string, TH1F*>> added;
+            for (size_t i = 0; i < drawnRuns_.size(); i++) {
+                added.push_back({drawnRuns_[i].first, overlayHists_[i]});
+            }
+            overlayHists_.clear();
+            drawnRuns_.clear();
+            if (added.empty()) {
+                continue;
+            }
+            
+            // Add only the new curves to the histogram's own canvas
+            StageTimer timer;
+            LiveOverlay& live = live_[spec.histName];
+            if (!live.canvas) {
+                live.canvas = new TCanvas(("cLive_" + spec.histName).c_str(), spec.title.c_str(), 800, 600);
+                live.canvas->SetLogy();
+                live.canvas->SetGrid();
+                live.legend = NewLegend();
+            }
+            live.canvas->cd();
+            for (const auto& curve : added) {
+                curve.second->Draw(live.curves.empty() ? "HIST" : "HIST SAME");
+                live.legend->AddEntry(curve.second, Form("Run: %s", curve.first.c_str()), "l");
+                live.curves.push_back(curve);
+            }
+            if (compare_ && !live.reference && comparator_.GetReference(spec.histName)) {
+                live.reference = ReferenceCopy(spec.histName);
+                live.reference->Draw("HIST SAME");
+                live.legend->AddEntry(live.reference, Form("Reference (%d good runs)", comparator_.ReferenceSize(spec.histName)), "l");
+            }
+            TList* primitives = live.canvas->GetListOfPrimitives();
+            if (maxLiveRuns_ > 0 && live.curves.size() > maxLiveRuns_) {
+                while (live.curves.size() > maxLiveRuns_) {
+                    TH1F* oldest = live.curves.front().second;
+                    live.curves.pop_front();
+                    RemoveLegendEntry(live.legend, oldest);
+                    primitives->Remove(oldest);
+                    delete oldest;
+                }
+                // The oldest remaining curve now draws the axes
+                primitives->Remove(live.curves.front().second);
+                primitives->AddFirst(live.curves.front().second, "HIST");
+            }
+            // The new curves were painted last, so the legend and label go back on top of them
+            primitives->Remove(live.legend);
+            live.legend->Draw();
+            if (live.label) {
+                primitives->Remove(live.label);
+                live.label->Draw();
+            } else {
+                TLatex sphenixLabel;
+                sphenixLabel.SetTextSize(0.03);
+                live.label = sphenixLabel.DrawLatexNDC(0.67, 0.575, "sPHENIX EMCal QA");
+            }
+            live.canvas->Modified();
+            live.canvas->Update();
+            StageRecord timing;
+            timing.run = "*";
+            timing.histName = spec.histName;
+            timing.ms[kStageDraw] = timer.Lap();
+            writer_.Save(live.canvas, GetOutputFile(spec.histName), "");
+            timing.ms[kStageSave] = timer.Lap();
+            if (timing_) {
+                timingReport_.Add(timing);
+            }
+        }
+        writer_.Flush();
+        if (compare_ && !comparisonCsv_.empty()) {
+            comparator_.WriteCSV(comparisonCsv_);
+        }
+        WriteReports("");
+    }
+    
+    // Number of forked worker processes used by OverlayAll (1 = render overlays one after another)
+    void SetNProcesses(unsigned nProcesses) { nProcesses_ = nProcesses; }
+    
+    // Function to produce the overlays for several histogram types
+    // With more than one process, every overlay is rendered by its own forked worker. The runs are loaded into
+    // the shared cache beforehand, so the workers inherit the histograms instead of each reading every file again.
+    // With comparison enabled every run is scored first and only the overlays selected by the render mode are drawn.
+    void OverlayAll(const std::vector<HistSpec>& allSpecs) {
+        summary_.Clear();
+        timingReport_.Clear();
+        if (compare_) {
+            CompareAll(allSpecs);
+        }
+        std::vector<HistSpec> specs;
+        for (const auto& spec : allSpecs) {
+            if (IsRendered(spec.histName)) {
+                specs.push_back(spec);
+            }
+        }
+        unsigned nProcesses = std::min<unsigned>(nProcesses_, specs.size());
+        if (nProcesses <= 1) {
+            for (const auto& spec : specs) {
+                Overlay(spec.histName, spec.title, spec.xAxisTitle, spec.yAxisTitle);
+            }
+            writer_.Flush();
+            WriteReports("");
+            return;
+        }
+        
+        // Read every run once in the parent process
+        if (logLevel_ >= LogLevel::kInfo) {
+            std::cout << "Loading " << catalog_.Size() << " runs before forking " << nProcesses << " overlay workers\n";
+        }
+        for (const auto& info : catalog_) {
+            FetchCachedRun(info.run, Timing());
+        }
+        norms_.Build(catalog_);
+        // The parent's part of the reports is the file reading; the workers report their own overlays
+        WriteReports("load");
+        summary_.Clear();
+        timingReport_.Clear();
+        
+        // Workers must not share a graphics connection; each one owns its copy of the canvas and legend
+        gROOT->SetBatch(kTRUE);
+        writer_.StopEncoders();
+        std::vector<HistSpec> tasks(specs);
+        ROOT::TProcessExecutor pool(nProcesses);
+        std::vector<int> done = pool.Map([this](const HistSpec& spec) {
+            Overlay(spec.histName, spec.title, spec.xAxisTitle, spec.yAxisTitle);
+            // The worker exits after returning, so its queued image has to be written first
+            writer_.Flush();
+            // Each worker writes its part of the reports; the parent joins the parts below
+            WriteReports(spec.histName);
+            return 1;
+        }, tasks);
         
-        // Loop over all specified run numbers
-        for (const auto& run : runNumbers_) {
-            OverlayRun(run, histName, title, xAxisTitle, yAxisTitle);
+        int nDone = 0;
+        for (int d : done) {
+            nDone += d;
+        }
+        if (logLevel_ >= LogLevel::kInfo) {
+            std::cout << "Overlay workers finished " << nDone << " of " << specs.size() << " overlays\n";
         }
         
-        // Drawing the legend and other labels
-        leg_->Draw();
-        TLatex sphenixLabel;
-        sphenixLabel.SetTextSize(0.03);
-        sphenixLabel.DrawLatexNDC(0.67, 0.575, "sPHENIX EMCal QA");
-        cOverlay_->SetTitle(title.c_str());
-        cOverlay_->Update();
-        cOverlay_->SaveAs(("/Users/patsfan753/Desktop/QA_EMCal/OverlayedPlotOutput/Overlayed_" + histName + "_QA_October.png").c_str());
+        std::vector<std::string> parts = {"load"};
+        for (const auto& spec : specs) {
+            parts.push_back(spec.histName);
+        }
+        if (!summaryFile_.empty() && summaryFile_ != "-") {
+            JoinParts(summaryFile_, parts, false);
+        }
+        if (timing_ && !timingCsv_.empty()) {
+            JoinParts(timingCsv_, parts, true);
+        }
     }
 
 
 private:
     // Attributes for the class
     bool normalize_;
+    unsigned nProcesses_ = 1;
+    bool prefetch_ = false;     // Whether to read the next run in the background while the current one is drawn
+    bool compare_ = false;      // Whether to score the runs against the reference before drawing
+    RenderMode render_ = RenderMode::kAll;  // Overlays drawn after the comparison
+    RunComparator comparator_;              // References and scores of the comparison
+    std::string comparisonCsv_;             // Where to write the scores, empty for none
+    bool releaseCachedHists_ = false;
+    std::string outputDir_ = "/Users/patsfan753/Desktop/QA_EMCal/OverlayedPlotOutput/";
+    LogLevel logLevel_ = LogLevel::kInfo;   // Console verbosity
+    std::string summaryFile_;               // Where to write the per-run summary, empty for none
+    PlotSummaryLog summary_;                // Per-run outcomes of the overlays made so far
     TCanvas* cOverlay_;
+    PlotWriter writer_;                     // Output format and encoding of the overlays
     TLegend* leg_;
-    std::unordered_map<std::string, RunData> runDataMap_ = {
-        // (Run Number: {Color, SEB Count})
-        {"21813", {kBlue, 7}},
-        {"21796", {kOrange+7, 8}},
-        {"21615", {kBlack, 8}},
-        {"21599", {kBlue+3, 8}},
-        {"21598", {kRed, 8}},
-        {"21891", {kCyan+3, 7}},
-        {"22979", {kMagenta, 5}},
-        {"22950", {kViolet+1, 5}},
-        {"22949", {kMagenta+2, 5}},
-        {"22951", {kAzure+4, 5}},
-        {"22982", {kAzure+2, 5}},
-        {"21518", {kPink-3, 8}},
-        {"21520", {kOrange+1, 8}},
-        {"21889", {kGray+1, 7}}
+    std::vector<TH1F*> overlayHists_;   // Detached histograms drawn on cOverlay_, owned by the plotter
+    std::vector<std::pair<std::string, const TH1F*>> drawnRuns_;   // Run and full-resolution normalized histogram of each overlaid run
+    std::vector<TH1F*> fullResHists_;   // Full-resolution copies kept for the ratios of display-merged runs, owned by the plotter
+    
+    // Watch mode: canvas of one histogram kept between AppendRuns calls, with everything drawn on it
+    struct LiveOverlay {
+        TCanvas* canvas = nullptr;
+        TLegend* legend = nullptr;
+        std::deque<std::pair<std::string, TH1F*>> curves;  // (run, owned drawn copy), oldest first
+        TH1F* reference = nullptr;      // Owned copy of the comparison reference, once there is one
+        TLatex* label = nullptr;        // Experiment label, owned by the canvas
     };
+    std::map<std::string, LiveOverlay> live_;   // Watch mode: histogram -> its kept overlay
+    size_t maxLiveRuns_ = 0;                // Watch mode: most curves kept per overlay, 0 = every run
+    RunGrouping grouping_ = RunGrouping::kNone;     // How the runs are split into canvases
+    size_t maxGroupSize_ = 0;               // Most runs on one canvas, 0 = all runs on one canvas
+    int maxDisplayBins_ = 0;                // Most bins drawn per histogram, 0 = draw every bin
+    RatioReference ratio_ = RatioReference::kNone;  // Denominator of the ratio pad, kNone for no ratio pad
+    std::string ratioRun_;                  // Reference run of RatioReference::kRun
+    double ratioMin_ = 0.0;                 // Y range of the ratio pad
+    double ratioMax_ = 2.0;
+    
+    // Runs to overlay, with their colors and SEB counts
+    RunCatalog catalog_ = RunCatalog::Default();
+    
+    // Normalization of each run in catalog_, computed once per run and shared by every overlay
+    NormalizationTable norms_;
+    
+    bool timing_ = false;                   // Whether to record per-stage timings
+    std::string timingCsv_;                 // Where to write the timing records, empty for none
+    TimingReport timingReport_;             // Per-stage timings of the overlays made so far
+    
+    // Temporary file holding one worker's part of a report
+    static std::string PartFile(const std::string& path, const std::string& part) {
+        return path + ".part_" + part;
+    }
+    
+    // Write the summary and timing reports; a non-empty part name writes them to that part's temporary files
+    void WriteReports(const std::string& part) {
+        summary_.PrintFailures();
+        if (!summaryFile_.empty()) {
+            summary_.Write(part.empty() || summaryFile_ == "-" ? summaryFile_ : PartFile(summaryFile_, part));
+        }
+        if (timing_) {
+            if (logLevel_ >= LogLevel::kInfo && !part.empty()) {
+                std::cout << "Timing for " << part << ":\n";
+            }
+            timingReport_.Print();
+            RunHistCache::Instance().PrintStats();
+            if (!timingCsv_.empty()) {
+                timingReport_.WriteCSV(part.empty() ? timingCsv_ : PartFile(timingCsv_, part));
+            }
+        }
+    }
+    
+    // Concatenate the workers' temporary files into path and remove them
+    // skipHeaders drops the first line of every part after the first (CSV headers)
+    static void JoinParts(const std::string& path, const std::vector<std::string>& parts, bool skipHeaders) {
+        std::ofstream out(path);
+        for (size_t i = 0; i < parts.size(); i++) {
+            const std::string partPath = PartFile(path, parts[i]);
+            std::ifstream in(partPath);
+            std::string line;
+            for (int lineNumber = 0; std::getline(in, line); lineNumber++) {
+                if (!(skipHeaders && i > 0 && lineNumber == 0)) {
+                    out << line << '\n';
+                }
+            }
+            in.close();
+            std::remove(partPath.c_str());
+        }
+    }
+    
+    // Timing report receiving the file reads, nullptr when timing is off
+    TimingReport* Timing() { return timing_ ? &timingReport_ : nullptr; }
+    
+    // Normalized working copy of a run's histogram for the comparison, nullptr if the run or histogram is unusable
+    TH1F* NormalizedCopy(const RunInfo& info, const std::string& histName) {
+        const RunHistCache::RunEntry& runEntry = FetchCachedRun(info.run, Timing());
+        if (!runEntry.fileOk || runEntry.nEvents < 0) {
+            return nullptr;
+        }
+        TH1F* hist = RunHistCache::Instance().CloneHist(info.run, histName, "compare_" + histName + "_" + info.run);
+        if (hist && normalize_) {
+            ApplyNormalization(hist, norms_.Get(info));
+        }
+        return hist;
+    }
+    
+    // Split the canvas into the overlay pad (1) and the ratio pad (2) below it, and make the overlay pad current
+    // (the pads belong to the canvas and are deleted by its next Clear())
+    void SplitCanvas() {
+        cOverlay_->Divide(1, 2);
+        TVirtualPad* upper = cOverlay_->GetPad(1);
+        upper->SetPad(0.0, 0.3, 1.0, 1.0);
+        upper->SetBottomMargin(0.02);
+        upper->SetLogy();
+        upper->SetGrid();
+        TVirtualPad* lower = cOverlay_->GetPad(2);
+        lower->SetPad(0.0, 0.0, 1.0, 0.3);
+        lower->SetTopMargin(0.02);
+        lower->SetBottomMargin(0.3);
+        lower->SetGrid();
+        cOverlay_->cd(1);
+    }
     
-    //List of run numbers
-    std::vector<std::string> runNumbers_;
+    // Draw every overlaid run divided by the ratio reference on the ratio pad
+    // Uses the full-resolution normalized histograms of the overlaid runs; nothing is read from the cache or the files again
+    void DrawRatios(const std::string& histName) {
+        if (drawnRuns_.empty()) {
+            return;
+        }
+        const TH1F* den = nullptr;
+        std::string yTitle;
+        if (ratio_ == RatioReference::kRun) {
+            for (const auto& drawn : drawnRuns_) {
+                if (drawn.first == ratioRun_) {
+                    den = drawn.second;
+                }
+            }
+            if (!den) {
+                std::cout << "Ratio issue: reference run " << ratioRun_ << " is not on the " << histName << " overlay" << std::endl;
+                return;
+            }
+            yTitle = "Ratio to run " + ratioRun_;
+        } else {
+            std::vector<const TH1F*> hists;
+            for (const auto& drawn : drawnRuns_) {
+                hists.push_back(drawn.second);
+            }
+            TH1F* average = (TH1F*)drawnRuns_.front().second->Clone(("ratio_average_" + histName).c_str());
+            average->SetDirectory(nullptr);
+            const int nAveraged = FillAverage(hists, average);
+            overlayHists_.push_back(average);
+            if (nAveraged == 0) {
+                return;
+            }
+            den = average;
+            yTitle = "Ratio to average";
+        }
+        
+        cOverlay_->cd(2);
+        bool first = true;
+        for (size_t i = 0; i < drawnRuns_.size(); i++) {
+            const TH1F* hist = drawnRuns_[i].second;
+            // The clone keeps the run's binning and style; its contents are overwritten by the ratio
+            TH1F* ratio = (TH1F*)hist->Clone(("ratio_" + histName + "_" + drawnRuns_[i].first).c_str());
+            ratio->SetDirectory(nullptr);
+            if (!FillRatio(hist, den, ratio)) {
+                std::cout << "Ratio issue: run " << drawnRuns_[i].first << " " << histName << " has a different binning than the reference, no ratio drawn" << std::endl;
+                delete ratio;
+                continue;
+            }
+            // Computed at full resolution, merged (as a mean, not a sum) only for drawing
+            ratio = DownsampleForDisplay(ratio, maxDisplayBins_, true);
+            overlayHists_.push_back(ratio);
+            if (first) {
+                first = false;
+                // The lower pad is 30% of the canvas, so its axis text is scaled up to stay readable
+                ratio->SetTitle("");
+                ratio->SetMinimum(ratioMin_);
+                ratio->SetMaximum(ratioMax_);
+                ratio->GetYaxis()->SetTitle(yTitle.c_str());
+                ratio->GetYaxis()->SetTitleSize(0.09);
+                ratio->GetYaxis()->SetTitleOffset(0.5);
+                ratio->GetYaxis()->SetLabelSize(0.08);
+                ratio->GetYaxis()->SetNdivisions(505);
+                ratio->GetXaxis()->SetTitleSize(0.1);
+                ratio->GetXaxis()->SetLabelSize(0.09);
+                ratio->Draw("HIST");
+            } else {
+                ratio->Draw("HIST SAME");
+            }
+        }
+        cOverlay_->cd(1);
+    }
+    
+    // Watch mode comparison: build the reference of histName from the runs so far (first call),
+    // or score each new run against the reference kept from the first call
+    void ScoreNewRuns(const std::vector<RunInfo>& runs, const std::string& histName) {
+        if (comparator_.ReferenceSize(histName) == 0) {
+            Compare(histName);
+            return;
+        }
+        for (const auto& info : runs) {
+            TH1F* hist = NormalizedCopy(info, histName);
+            if (!hist) {
+                continue;
+            }
+            const RunScore& score = comparator_.Score(info.run, histName, hist);
+            if (score.flagged && logLevel_ >= LogLevel::kInfo) {
+                std::cout << "Flagged: run " << info.run << " " << histName << " (KS prob " << score.ksProb << ", chi2/ndf "
+                          << score.chi2Ndf << ")\n";
+            }
+            delete hist;
+        }
+    }
+    
+    // Legend of an overlay canvas, empty
+    static TLegend* NewLegend() {
+        TLegend* legend = new TLegend(0.6, 0.6, 0.9, 0.9);
+        legend->SetNColumns(2);
+        legend->SetFillColorAlpha(0, 0.2);
+        legend->SetBorderSize(1);
+        legend->SetMargin(0.15);
+        legend->SetTextSize(0.025);
+        return legend;
+    }
     
-    // Function to overlay the histogram data for a specific run.
-    void OverlayRun(const std::string& run,        // The specific run number to process.
+    // Delete the legend entry of hist, if it has one
+    static void RemoveLegendEntry(TLegend* legend, const TObject* hist) {
+        TList* entries = legend->GetListOfPrimitives();
+        TIter next(entries);
+        while (TLegendEntry* entry = (TLegendEntry*)next()) {
+            if (entry->GetObject() == hist) {
+                entries->Remove(entry);
+                delete entry;
+                return;
+            }
+        }
+    }
+    
+    // Detached display copy of the reference of histName, styled as a thick dashed black line; owned by the caller
+    TH1F* ReferenceCopy(const std::string& histName) {
+        TH1F* ref = (TH1F*)comparator_.GetReference(histName)->Clone(("overlay_reference_" + histName).c_str());
+        ref->SetDirectory(nullptr);
+        ref = DownsampleForDisplay(ref, maxDisplayBins_);
+        ref->SetStats(kFALSE);
+        ref->SetLineColor(kBlack);
+        ref->SetLineStyle(2);
+        ref->SetLineWidth(2);
+        return ref;
+    }
+    
+    // Draw a copy of the reference of histName on the overlay as a thick dashed black line
+    // same draws it over the curves already on the canvas instead of starting a fresh plot
+    void DrawReference(const std::string& histName, bool same) {
+        TH1F* ref = ReferenceCopy(histName);
+        ref->Draw(same ? "HIST SAME" : "HIST");
+        overlayHists_.push_back(ref);
+        leg_->AddEntry(ref, Form("Reference (%d good runs)", comparator_.ReferenceSize(histName)), "l");
+    }
+    
+    // Function to overlay the histogram data for a specific run; returns the run's status for the summary.
+    std::string OverlayRun(const RunInfo& info,           // Catalog entry of the run to process.
                     const std::string& histName,   // The name of the histogram to overlay.
                     const std::string& title,      // Title for the histogram.
                     const std::string& xAxisTitle, // Title for the X-axis.
-                    const std::string& yAxisTitle) // Title for the Y-axis.
+                    const std::string& yAxisTitle, // Title for the Y-axis.
+                    RunLog& log,                   // Buffered console output for this run.
+                    std::string& error,            // Receives the reason if the run cannot be overlaid.
+                    bool draw = true)              // Whether to draw it on cOverlay_ (AppendRuns draws on its own canvas).
     {
-        // Base directory where the root output files are stored.
-        const char *baseDir = "/Users/patsfan753/Desktop/QA_EMCal/rootOutput/";
-        // Constructs the full file path using the base directory and the run number.
-        std::string filePath = baseDir + run + "/qa.root";
+        const std::string& run = info.run;
         
         // Notify the user about the run currently being processed.
-        std::cout << "\nProcessing data for run: " << run << std::endl;
-        
+        log.Info() << "\nProcessing data for run: " << run << "\n";
         
-        // Open the ROOT file for the specified run.
-        TFile *file = TFile::Open(filePath.c_str());
+        // Fetch the run from the shared cache; its qa.root is only opened the first time any plotter asks for it.
+        RunHistCache& cache = RunHistCache::Instance();
+        const RunHistCache::RunEntry& runEntry = FetchCachedRun(run, Timing());
+        StageRecord timing;
+        timing.run = run;
+        timing.histName = histName;
+        StageTimer timer;
         
         // Check if the file opened correctly and is not corrupted.
-        if (!file || file->IsZombie()) {
-            std::cout << "File issue for run: " << run << std::endl;
-            return;
+        if (!runEntry.fileOk) {
+            log.Error() << "File issue for run: " << run << " (" << runEntry.error << ")\n";
+            error = runEntry.error;
+            return "file_error";
+        }
+        if (runEntry.attempts > 1) {
+            log.Info() << "Opened after " << runEntry.attempts << " attempts\n";
         }
         
-        // Extract the specified histogram from the file.
-        TH1F *hist = (TH1F*)file->Get(histName.c_str());
+        // Take a working copy of the specified histogram, leaving the cached one untouched by normalization.
+        // The copy is detached from any file or directory and owned by the plotter until ResetCanvas().
+        TH1F *hist = cache.CloneHist(run, histName, "overlay_" + histName + "_" + run);
         // Print the name of the histogram being accessed
-        std::cout << "Accessing histogram: " << histName << std::endl;
+        log.Debug() << "Accessing histogram: " << histName << "\n";
         
-        // Extract another histogram named "hNClusters" from the file.
-        TH1F *hNClusters = (TH1F*)file->Get("hNClusters");
-        // Check for potential issues with the histograms.
-        if (!hist || !hNClusters) {
-            std::cout << "Histogram issue for run: " << run << std::endl;
-            return;
+        // Check for potential issues with the histogram and the hNClusters event count.
+        if (!hist || runEntry.nEvents < 0) {
+            log.Error() << "Histogram issue for run: " << run << "\n";
+            error = (hist ? std::string("hNClusters") : histName) + " not found";
+            delete hist;
+            return "hist_error";
         }
+        overlayHists_.push_back(hist);
+        drawnRuns_.push_back({run, hist});
+        timing.ms[kStageGet] = timer.Lap();
         
-        // Get the color assigned to the current run from the map.
-        Color_t color = runDataMap_[run].color;
-        std::cout << "Color assigned: " << color << std::endl;
-        std::cout << "SEB count for the run: " << runDataMap_[run].sebCount << std::endl;
+        // Get the color assigned to the current run from the catalog.
+        Color_t color = info.color;
+        log.Debug() << "Color assigned: " << color << "\n";
+        log.Debug() << "SEB count for the run: " << info.sebCount << "\n";
         
         // Disable the statistics box for the histogram since doesnt provide information for overlayed plots
         hist->SetStats(kFALSE);
-        int nEvents = 0;
-        int nSEBs = 0;
         
         // If normalization is enabled, scale the histogram based on the number of events and SEBs.
         if (normalize_) {
-            nEvents = hNClusters->GetEntries();
-            nSEBs = runDataMap_[run].sebCount;
-            Normalize(hist, nEvents, nSEBs);
+            ApplyNormalization(hist, norms_.Get(info));
+        }
+        // Ratios are formed from a full-resolution copy; only the drawn curve is merged for display
+        TH1F* full = nullptr;
+        if (ratio_ != RatioReference::kNone && maxDisplayBins_ > 0 && hist->GetNbinsX() > maxDisplayBins_) {
+            full = (TH1F*)hist->Clone((std::string(hist->GetName()) + "_full").c_str());
+            full->SetDirectory(nullptr);
+            fullResHists_.push_back(full);
         }
+        hist = DownsampleForDisplay(hist, maxDisplayBins_);
+        overlayHists_.back() = hist;
+        drawnRuns_.back().second = full ? full : hist;
+        timing.ms[kStageNormalize] = timer.Lap();
         // Styling for the histogram.
         hist->SetLineWidth(1);  // Setting the line width to half the default width
 
@@ -171,76 +856,187 @@ private:
 
         // Adjust the position of the Y-axis title.
         hist->GetYaxis()->SetTitleOffset(1.4);
-        
-        // Draw the histogram. If it's the first run, draw a fresh plot; otherwise, overlay on the existing plot.
-        if (run == *runNumbers_.begin()) {
-            hist->Draw("HIST");
-        } else {
-            hist->Draw("HIST SAME");
+        // The ratio made from the full-resolution copy takes its style
+        if (full) {
+            full->SetLineColor(color);
+            full->SetMarkerColor(color);
+            full->GetXaxis()->SetTitle(xAxisTitle.c_str());
         }
         
-        // Add the histogram to the legend with the run number.
-        leg_->AddEntry(hist, Form("Run: %s", run.c_str()), "l");
-        std::cout << "Completed for run: " << run << std::endl;
-        
-    }
-    
-    // Function to normalize the histogram by the number of events and SEBs.
-    void Normalize(TH1F* h,        // The histogram to normalize.
-                   int nEvents,    // The number of events for the specific run.
-                   int nSEBs)      // The number of SEBs for the specific run.
-    {
-        // Normalize the histogram if both numbers are greater than zero.
-        if (nEvents > 0 && nSEBs > 0) {
-            h->Scale(1.0 / (nEvents * nSEBs));
+        // Draw the histogram. If it's the first one on the canvas, draw a fresh plot; otherwise, overlay on the existing plot.
+        if (draw) {
+            if (overlayHists_.size() == 1) {
+                hist->Draw("HIST");
+            } else {
+                hist->Draw("HIST SAME");
+            }
+            
+            // Add the histogram to the legend with the run number.
+            leg_->AddEntry(hist, Form("Run: %s", run.c_str()), "l");
+        }
+        timing.ms[kStageDraw] = timer.Lap();
+        if (timing_) {
+            timingReport_.Add(timing);
         }
+        log.Debug() << "Completed for run: " << run << "\n";
+        return "ok";
     }
+    
 };
 
-// Main function to generate overlay plots for various histograms.
-void OverlayedPlotGenerator() {
-    // Create an instance of the OverlayPlotter class with normalization enabled.
-    OverlayPlotter overlayPlotter(true);
-    
-    // Generate overlay plots for different types of histograms with their respective titles
-    
-    // Chi2 Plot
-    overlayPlotter.Overlay(
-        "hClusterChi",
-        "Cluster #chi^{2} Distribution",
-        "Cluster #chi^{2}",
-        "Counts"
-    );
+// Struct to hold every setting of an OverlayedPlotGenerator pass
+struct OverlayPlotConfig {
+    bool normalize = true;      // Normalize by number of events and SEB count
+    int nProcesses = 1;         // Forked processes rendering overlays concurrently
+    std::string runList;        // Optional CSV run catalog, empty for the default runs
+    int minRun = 0;             // Only runs from this run number on, 0 = no lower limit
+    int maxRun = 0;             // Only runs up to this run number, 0 = no upper limit
+    bool goodOnly = false;      // Only the runs flagged good in the catalog
+    std::string dbUrl;          // Run database (e.g. mysql://host/db) queried instead of runList, empty for none
+    std::string dbUser;         // Run database user
+    std::string dbPassword;     // Run database password
+    std::string dbQuery;        // Query returning run, sebCount and (optionally) a good-run flag
+    std::string inputDir;       // Directory or URL (root://...) holding <run>/qa.root, empty for the default
+    std::string outputDir;      // Directory for the overlay images, empty for the default
+    LogLevel logLevel = LogLevel::kInfo;    // Console verbosity
+    std::string summaryFile;    // Optional JSON-lines run summary ("-" = standard output)
+    bool timing = false;        // Print a per-stage timing table at the end
+    std::string timingCsv;      // Optional CSV with the per-stage timing of every run and overlay
+    bool prefetch = false;      // Read the next run in the background while the current one is drawn
+    int openTimeout = 0;        // Seconds before an open of a (remote) qa.root gives up, 0 = no timeout
+    int openRetries = 0;        // Extra attempts at opening a qa.root that failed to open
+    double memoryBudgetMB = 0;  // Memory cap of the histogram cache in MB (least recently used evicted first), 0 = unlimited
+    std::string format = "png"; // Image format of the overlays (png, pdf, svg, ...)
+    int pngCompression = -1;    // PNG compression level 0-100, -1 for ROOT's default
+    unsigned nEncoders = 0;     // Background PNG encoder threads, 0 to encode on the plotting thread
+    std::string cacheFile;      // Consolidated cache file, empty for <inputDir>/qa_consolidated.root if present
+    bool checkStale = false;    // Read runs reprocessed since the consolidation from qa.root (one stat per run)
+    bool compare = false;       // Score every run against the mean of the good runs and print the outliers
+    RenderMode render = RenderMode::kAll;   // Overlays drawn after the comparison (all, flagged runs only, none)
+    double minKsProb = 0.01;    // Flag runs with a lower KS probability
+    double maxChi2Ndf = 5.0;    // Flag runs with a larger chi2/ndf
+    std::string comparisonCsv;  // Optional CSV with the scores of every run
+    RatioReference ratio = RatioReference::kNone;   // Ratio pad denominator: none, a reference run or the run average
+    std::string ratioRun;       // Reference run of the ratio pad (RatioReference::kRun)
+    RunGrouping grouping = RunGrouping::kNone;  // Split the runs by SEB count or run range
+    unsigned maxGroupSize = 0;  // Most runs per canvas, 0 = unbounded
+    bool multiPagePdf = false;  // One PDF per histogram with a page per group
+    int maxDisplayBins = 0;     // Most bins drawn per histogram (merged for display only), 0 = every bin
+    std::string shard;          // "i/N": only write the partial file of the i-th of N run subsets, no overlays (see QAShard.h)
+    std::string partialDir;     // Directory of the shard partial files, empty for <inputDir>/qa_shards/
+    bool mergeShards = false;   // Overlay the runs of the shardCount partial files in partialDir instead of reading qa.root
+    int shardCount = 0;         // Number of shards the campaign was split into (mergeShards)
+};
+
+// Generate the overlay plots with the given settings
+void RunOverlayPlots(const OverlayPlotConfig& config) {
+    // Forked workers need batch mode, which has to be set before the canvas is created
+    if (config.nProcesses > 1) {
+        gROOT->SetBatch(kTRUE);
+    }
+    
+    // Create an instance of the OverlayPlotter class
+    OverlayPlotter overlayPlotter(config.normalize);
+    overlayPlotter.SetNProcesses(config.nProcesses);
+    overlayPlotter.SetPrefetch(config.prefetch);
+    overlayPlotter.SetOutputFormat(config.format, config.pngCompression);
+    overlayPlotter.SetAsyncEncoding(config.nEncoders > 0, config.nEncoders);
+    overlayPlotter.SetReleaseCachedHists(true);
+    overlayPlotter.SetLogLevel(config.logLevel);
+    overlayPlotter.SetSummaryFile(config.summaryFile);
+    overlayPlotter.SetTiming(config.timing, config.timingCsv);
+    overlayPlotter.SetComparison(config.compare, config.render);
+    overlayPlotter.SetComparisonThresholds(config.minKsProb, config.maxChi2Ndf);
+    overlayPlotter.SetComparisonFile(config.comparisonCsv);
+    overlayPlotter.SetRatioPanel(config.ratio, config.ratioRun);
+    overlayPlotter.SetGrouping(config.grouping, config.maxGroupSize);
+    overlayPlotter.SetMultiPagePdf(config.multiPagePdf);
+    overlayPlotter.SetMaxDisplayBins(config.maxDisplayBins);
+    ShardSpec shard;
+    if (!config.shard.empty() && !ParseShard(config.shard, shard)) {
+        std::cerr << "Error: invalid shard \"" << config.shard << "\", expected i/N with 0 <= i < N" << std::endl;
+        return;
+    }
+    RunCatalog catalog = RunCatalog::Load(config.runList, config.dbUrl, config.dbUser, config.dbPassword, config.dbQuery)
+        .Filter(config.minRun, config.maxRun, config.goodOnly);
+    ConfigureRunCache(config.inputDir, config.cacheFile, config.openTimeout, config.openRetries, config.memoryBudgetMB, config.checkStale);
+    if (!config.outputDir.empty()) {
+        overlayPlotter.SetOutputDir(config.outputDir);
+    }
+    const std::string partialDir = config.partialDir.empty() ? DefaultShardDir() : config.partialDir;
+    if (shard.IsSharded()) {
+        // An overlay needs every run, so a shard only contributes its partial file to the merge step
+        PrepareShard(catalog, shard, partialDir);
+        return;
+    }
+    if (config.mergeShards && MergeShards(catalog, partialDir, config.shardCount) == 0) {
+        return;
+    }
+    overlayPlotter.SetRunCatalog(catalog);
+    
+    // Generate overlay plots for the standard QA histograms with their respective titles
+    overlayPlotter.OverlayAll(DefaultHistSpecs());
+}
 
-    // MBD Charge Plot
-    overlayPlotter.Overlay(
-        "hTotalMBD",
-        "MBD Charge Distribution",
-        "MBD Charge",
-        "Counts"
-    );
+// Headless entry point for cron/batch jobs: forces batch mode before any canvas is created
+// Example: root -l -b -q -e '.L OverlayedPlotGenerator.cpp' -e 'OverlayedPlotGeneratorBatch(config)'
+void OverlayedPlotGeneratorBatch(const OverlayPlotConfig& config) {
+    gROOT->SetBatch(kTRUE);
+    RunOverlayPlots(config);
+}
 
-    // Cluster pT Plot
-    overlayPlotter.Overlay(
-        "hClusterPt",
-        "Cluster p_{T} Good Runs Distribution",
-        "Cluster p_{T} (GeV)",
-        "Counts"
-    );
+// Headless entry point taking the settings as plain arguments, for use straight from the command line
+// verbosity: 0 = quiet, 1 = info, 2 = debug; summaryFile: optional JSON-lines run summary ("-" = standard output)
+// Example: root -l -b -q -e '.L OverlayedPlotGenerator.cpp' -e 'OverlayedPlotGeneratorBatch(5, "", 0, "-")'
+void OverlayedPlotGeneratorBatch(int nProcesses = 1, const char* runList = "", int verbosity = 1, const char* summaryFile = "") {
+    OverlayPlotConfig config;
+    config.nProcesses = nProcesses;
+    config.runList = runList ? runList : "";
+    config.logLevel = LogLevelFromInt(verbosity);
+    config.summaryFile = summaryFile ? summaryFile : "";
+    OverlayedPlotGeneratorBatch(config);
+}
 
-    // Cluster Energy Plot
-    overlayPlotter.Overlay(
-        "hTotalCaloE",
-        "Total Calorimeter Energy Distribution",
-        "Cluster Energy (GeV)",
-        "Counts"
-    );
+// Headless outlier screening: scores every run against the mean of the good runs and prints the ranked outliers
+// render: 0 = draw all overlays, 1 = only the flagged runs with the reference, 2 = no images at all
+// Example: root -l -b -q -e '.L OverlayedPlotGenerator.cpp' -e 'OverlayedPlotGeneratorCompare("runs.csv", 2, 0.01, 5, "scores.csv")'
+void OverlayedPlotGeneratorCompare(const char* runList = "", int render = 1, double minKsProb = 0.01, double maxChi2Ndf = 5.0,
+                                   const char* comparisonCsv = "", int verbosity = 1) {
+    OverlayPlotConfig config;
+    config.runList = runList ? runList : "";
+    config.compare = true;
+    config.render = (RenderMode)render;
+    config.minKsProb = minKsProb;
+    config.maxChi2Ndf = maxChi2Ndf;
+    config.comparisonCsv = comparisonCsv ? comparisonCsv : "";
+    config.logLevel = LogLevelFromInt(verbosity);
+    OverlayedPlotGeneratorBatch(config);
+}
+
+// Headless merge step of a campaign split into nShards: overlays and summary tables from the partial files in partialDir
+// Every run is read from the merged partial files, none from its qa.root; nothing is drawn if a shard's file is missing
+// partialDir: as given to the shard jobs, empty for <inputDir>/qa_shards/
+// Example: root -l -b -q -e '.L OverlayedPlotGenerator.cpp' -e 'OverlayedPlotGeneratorMerge(20, "/shared/partials/", "runs.csv", 4)'
+void OverlayedPlotGeneratorMerge(int nShards, const char* partialDir = "", const char* runList = "", int nProcesses = 1, bool compare = false,
+                                 int verbosity = 1, const char* summaryFile = "") {
+    OverlayPlotConfig config;
+    config.partialDir = partialDir ? partialDir : "";
+    config.mergeShards = true;
+    config.shardCount = nShards;
+    config.runList = runList ? runList : "";
+    config.nProcesses = nProcesses;
+    config.compare = compare;
+    config.logLevel = LogLevelFromInt(verbosity);
+    config.summaryFile = summaryFile ? summaryFile : "";
+    OverlayedPlotGeneratorBatch(config);
+}
 
-    // Cluster ECore Plot
-    overlayPlotter.Overlay(
-        "hClusterECore",
-        "Cluster ECore Distribution",
-        "Cluster ECore (GeV)",
-        "Counts"
-    );
+// Main function to generate overlay plots for various histograms.
+// nProcesses > 1 renders the overlays concurrently in forked worker processes.
+// runList optionally names a CSV run catalog (run,sebCount[,good[,color]]) to use instead of the default runs.
+void OverlayedPlotGenerator(int nProcesses = 1, const char* runList = "") {
+    OverlayPlotConfig config;
+    config.nProcesses = nProcesses;
+    config.runList = runList ? runList : "";
+    RunOverlayPlots(config);
 }
@@ -0,0 +1,203 @@
+// Run-vs-reference comparison for the EMCal QA plotting macros
+
+/*
+   COMPARISON OVERVIEW:
+   RunComparator scores every run against a reference histogram per histogram type, so outliers can be
+   found without looking at the overlays. The reference of a type is the bin-by-bin mean of the
+   normalized histograms of the good runs. Each run is then compared to it with a weighted chi2 test
+   (chi2/ndf and p-value) and a Kolmogorov-Smirnov test, and is flagged when either test falls outside
+   its threshold. Scoring only needs the histograms already loaded in the run cache, so it costs a small
+   fraction of drawing and encoding an overlay.
+*/
+
+#ifndef QA_COMPARE_H
+#define QA_COMPARE_H
+
+#include <TAxis.h>
+#include <TH1F.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Whether two 1D histograms have the same bins (count, axis range and, for variable bins, every edge),
+// i.e. whether their bin arrays can be combined cell by cell
+inline bool SameBinning(const TH1* a, const TH1* b) {
+    const TAxis* xa = a->GetXaxis();
+    const TAxis* xb = b->GetXaxis();
+    if (a->GetNcells() != b->GetNcells() || xa->GetNbins() != xb->GetNbins() || xa->GetXmin() != xb->GetXmin()
+        || xa->GetXmax() != xb->GetXmax()) {
+        return false;
+    }
+    if (xa->IsVariableBinSize() || xb->IsVariableBinSize()) {
+        for (int bin = 1; bin <= xa->GetNbins(); bin++) {
+            if (xa->GetBinLowEdge(bin) != xb->GetBinLowEdge(bin)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Which overlays are drawn once the runs are scored
+enum class RenderMode { kAll = 0, kFlagged = 1, kNone = 2 };
+
+// Struct to hold the comparison of one run's histogram with its reference
+struct RunScore {
+    std::string run;        // Run number
+    std::string histName;   // Histogram compared
+    double chi2Ndf = -1;    // chi2 / ndf against the reference, -1 if it could not be computed
+    double chi2Prob = -1;   // chi2 test p-value
+    double ksProb = -1;     // Kolmogorov-Smirnov probability
+    bool flagged = false;   // Outside one of the thresholds (or not comparable at all)
+};
+
+class RunComparator {
+public:
+    RunComparator() = default;
+    RunComparator(const RunComparator&) = delete;
+    RunComparator& operator=(const RunComparator&) = delete;
+    ~RunComparator() { Clear(); }
+
+    // Flag a run whose KS probability is below minKsProb or whose chi2/ndf is above maxChi2Ndf
+    void SetThresholds(double minKsProb, double maxChi2Ndf) {
+        minKsProb_ = minKsProb;
+        maxChi2Ndf_ = maxChi2Ndf;
+    }
+
+    // Add one normalized good run to the reference of its histogram type (the histogram is copied)
+    // Returns false, leaving the reference unchanged, if the run's binning does not match the reference
+    bool AddReference(const std::string& histName, const TH1F* hist, const std::string& run = "") {
+        auto& ref = references_[histName];
+        if (!ref.first) {
+            ref.first = (TH1F*)hist->Clone(("reference_" + histName).c_str());
+            ref.first->SetDirectory(nullptr);
+        } else if (!SameBinning(ref.first, hist) || !ref.first->Add(hist)) {
+            std::cout << "Comparison issue: run " << run << " " << histName << " has a different binning, left out of the reference" << std::endl;
+            return false;
+        }
+        ref.second++;
+        return true;
+    }
+
+    // Turn the accumulated sum into the mean; call once all good runs of histName are added
+    void FinishReference(const std::string& histName) {
+        auto it = references_.find(histName);
+        if (it != references_.end() && it->second.second > 1) {
+            it->second.first->Scale(1.0 / it->second.second);
+        }
+    }
+
+    // Mean histogram of the good runs, nullptr if no good run had histName
+    const TH1F* GetReference(const std::string& histName) const {
+        auto it = references_.find(histName);
+        return it == references_.end() ? nullptr : it->second.first;
+    }
+
+    // Number of good runs in the reference of histName
+    int ReferenceSize(const std::string& histName) const {
+        auto it = references_.find(histName);
+        return it == references_.end() ? 0 : it->second.second;
+    }
+
+    // Score one normalized run against the reference of histName and record the result
+    const RunScore& Score(const std::string& run, const std::string& histName, const TH1F* hist) {
+        RunScore score;
+        score.run = run;
+        score.histName = histName;
+        const TH1F* ref = GetReference(histName);
+        if (ref && SameBinning(ref, hist) && hist->Integral() > 0 && ref->Integral() > 0) {
+            // Both histograms are weighted (normalized), hence "WW"
+            double chi2 = 0;
+            int ndf = 0;
+            int igood = 0;
+            score.chi2Prob = hist->Chi2TestX(ref, chi2, ndf, igood, "WW");
+            score.chi2Ndf = ndf > 0 ? chi2 / ndf : -1;
+            score.ksProb = hist->KolmogorovTest(ref);
+        }
+        score.flagged = score.chi2Ndf < 0 || score.ksProb < minKsProb_ || score.chi2Ndf > maxChi2Ndf_;
+        scores_.push_back(score);
+        if (score.flagged) {
+            flagged_.insert({histName, run});
+        }
+        return scores_.back();
+    }
+
+    bool IsFlagged(const std::string& run, const std::string& histName) const {
+        return flagged_.count({histName, run}) > 0;
+    }
+
+    // Number of flagged runs of histName
+    size_t NFlagged(const std::string& histName) const {
+        size_t n = 0;
+        for (const auto& entry : flagged_) {
+            n += entry.first == histName;
+        }
+        return n;
+    }
+
+    const std::vector<RunScore>& Scores() const { return scores_; }
+
+    void Clear() {
+        for (auto& ref : references_) {
+            delete ref.second.first;
+        }
+        references_.clear();
+        scores_.clear();
+        flagged_.clear();
+    }
+
+    // Table of the flagged runs, worst first (lowest KS probability); maxRows = 0 prints all of them
+    void PrintOutliers(std::ostream& out = std::cout, size_t maxRows = 0) const {
+        std::vector<const RunScore*> ranked;
+        for (const auto& s : scores_) {
+            if (s.flagged) {
+                ranked.push_back(&s);
+            }
+        }
+        std::stable_sort(ranked.begin(), ranked.end(), [](const RunScore* a, const RunScore* b) { return a->ksProb < b->ksProb; });
+        out << "================ Outliers (" << ranked.size() << " of " << scores_.size() << " scored) ================\n";
+        if (ranked.empty()) {
+            out << std::flush;
+            return;
+        }
+        out << std::left << std::setw(10) << "run" << std::setw(20) << "hist" << std::right << std::setw(12) << "KS prob"
+            << std::setw(12) << "chi2/ndf" << std::setw(12) << "chi2 prob" << "\n";
+        for (size_t i = 0; i < ranked.size() && (maxRows == 0 || i < maxRows); i++) {
+            const RunScore* s = ranked[i];
+            out << std::left << std::setw(10) << s->run << std::setw(20) << s->histName << std::right << std::setprecision(4)
+                << std::setw(12) << s->ksProb << std::setw(12) << s->chi2Ndf << std::setw(12) << s->chi2Prob << "\n";
+        }
+        if (maxRows > 0 && ranked.size() > maxRows) {
+            out << "... " << ranked.size() - maxRows << " more\n";
+        }
+        out << std::setprecision(6) << std::flush;
+    }
+
+    // One line per scored run: run,hist,ks_prob,chi2_ndf,chi2_prob,flagged
+    void WriteCSV(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "Comparison issue: cannot write " << path << std::endl;
+            return;
+        }
+        out << "run,hist,ks_prob,chi2_ndf,chi2_prob,flagged\n";
+        for (const auto& s : scores_) {
+            out << s.run << "," << s.histName << "," << s.ksProb << "," << s.chi2Ndf << "," << s.chi2Prob << "," << s.flagged << "\n";
+        }
+    }
+
+private:
+    double minKsProb_ = 0.01;
+    double maxChi2Ndf_ = 5.0;
+    std::map<std::string, std::pair<TH1F*, int>> references_;  // Histogram type -> (reference, good runs in it)
+    std::vector<RunScore> scores_;                              // Scores in the order they were computed
+    std::set<std::pair<std::string, std::string>> flagged_;     // (histogram type, run) of every flagged run
+};
+
+#endif // QA_COMPARE_H
@@ -0,0 +1,39 @@
+// Shared core library of the EMCal QA plotting macros
+
+/*
+   QA CORE OVERVIEW:
+   This file gathers the code both plotters share (run catalog, run cache and histogram loading,
+   normalization, run fetching, run comparison and ratios, sharding, input watching, output, logging and timing) into one library with a dictionary.
+   QALoad.C builds it with ACLiC the first time and keeps the library, so later sessions only load it
+   instead of JIT-compiling the headers again; it is rebuilt automatically when one of its sources changes.
+   The headers stay header-only, so each macro library built by QALoad.C still compiles its own copy of
+   the inline code it uses; the library saves the interpreter's parsing, not compiled code. The one piece
+   of state the plotters must share, the RunHistCache instance, is defined here only: QALoad.C builds the
+   macros with QA_CORE_LIBRARY and links them against this library, so both plotters use the same cache
+   and share every run already read, without relying on the dynamic linker merging inline statics.
+*/
+
+#define QA_CORE_LIBRARY
+
+#include "QAHistSpec.h"
+#include "QARunCatalog.h"
+#include "QATiming.h"
+#include "QALogger.h"
+#include "QARunCache.h"
+#include "QANormalization.h"
+#include "QARunFetch.h"
+#include "QAPlotManifest.h"
+#include "QAPlotWriter.h"
+#include "QATreeRefill.h"
+#include "QACompare.h"
+#include "QARatio.h"
+#include "QARebin.h"
+#include "QAShard.h"
+#include "QAWatch.h"
+
+// The cache of the whole session (declared in QARunCache.h)
+// Intentionally never deleted: avoids destruction order issues with ROOT at exit
+RunHistCache& RunHistCache::Instance() {
+    static RunHistCache* cache = new RunHistCache();
+    return *cache;
+}
@@ -0,0 +1,60 @@
+// Dictionary of the shared QA core library (picked up by ACLiC when building QACore.cxx)
+
+#ifdef __CLING__
+
+#pragma link off all globals;
+#pragma link off all classes;
+#pragma link off all functions;
+
+#pragma link C++ struct HistSpec;
+#pragma link C++ struct RunInfo;
+#pragma link C++ class RunCatalog;
+#pragma link C++ enum RunGrouping;
+#pragma link C++ struct RunGroup;
+#pragma link C++ struct StageRecord;
+#pragma link C++ class StageTimer;
+#pragma link C++ class TimingReport;
+#pragma link C++ enum TimingStage;
+#pragma link C++ enum LogLevel;
+#pragma link C++ class RunLog;
+#pragma link C++ struct PlotSummary;
+#pragma link C++ class PlotSummaryLog;
+#pragma link C++ class RunHistCache;
+#pragma link C++ struct RunHistCache::RunEntry;
+#pragma link C++ struct RunHistCache::CacheStats;
+#pragma link C++ struct RunNormalization;
+#pragma link C++ class NormalizationTable;
+#pragma link C++ class PlotManifest;
+#pragma link C++ class PlotWriter;
+#pragma link C++ class ClusterTreeRefiller;
+#pragma link C++ struct ClusterTreeRefiller::Request;
+#pragma link C++ function SameBinning;
+#pragma link C++ enum RenderMode;
+#pragma link C++ struct RunScore;
+#pragma link C++ class RunComparator;
+#pragma link C++ enum RatioReference;
+#pragma link C++ function FillAverage;
+#pragma link C++ function FillRatio;
+#pragma link C++ function DownsampleForDisplay;
+#pragma link C++ struct ShardSpec;
+#pragma link C++ class RunWatcher;
+
+#pragma link C++ function DefaultHistSpecs;
+#pragma link C++ function LogLevelFromInt;
+#pragma link C++ function TimingStageName;
+#pragma link C++ function ApplyNormalization;
+#pragma link C++ function RecordFileRead;
+#pragma link C++ function FetchCachedRun;
+#pragma link C++ function PrefetchRun;
+#pragma link C++ function FinishPrefetch;
+#pragma link C++ function ConfigureRunCache;
+#pragma link C++ function ParseShard;
+#pragma link C++ function ShardDir;
+#pragma link C++ function ShardPartialPath;
+#pragma link C++ function ShardMergedPath;
+#pragma link C++ function DefaultShardDir;
+#pragma link C++ function FindShardPartials;
+#pragma link C++ function PrepareShard;
+#pragma link C++ function MergeShards;
+
+#endif
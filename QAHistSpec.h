@@ -0,0 +1,33 @@
+// Description of the QA histograms drawn by the EMCal QA plotting macros
+
+#ifndef QA_HIST_SPEC_H
+#define QA_HIST_SPEC_H
+
+#include <string>
+#include <vector>
+
+// Struct to hold the name and labels of one histogram to plot
+struct HistSpec {
+    std::string histName;      // Name of the histogram inside qa.root
+    std::string title;         // Plot title
+    std::string xAxisTitle;    // X-axis label
+    std::string yAxisTitle;    // Y-axis label
+};
+
+// The standard set of EMCal QA histograms, in the order they are plotted
+inline std::vector<HistSpec> DefaultHistSpecs() {
+    return {
+        // Chi^2 Plot
+        {"hClusterChi", "Cluster #chi^{2} Distribution", "Cluster #chi^{2}", "Counts"},
+        // MBD Charge Plot
+        {"hTotalMBD", "MBD Charge Distribution", "MBD Charge", "Counts"},
+        // Cluster pT Plot
+        {"hClusterPt", "Cluster p_{T} Good Runs Distribution", "Cluster p_{T} (GeV)", "Counts"},
+        // Cluster Energy Plot
+        {"hTotalCaloE", "Total Calorimeter Energy Distribution", "Cluster Energy (GeV)", "Counts"},
+        // Cluster ECore Plot
+        {"hClusterECore", "Cluster ECore Distribution", "Cluster ECore (GeV)", "Counts"}
+    };
+}
+
+#endif // QA_HIST_SPEC_H
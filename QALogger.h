@@ -0,0 +1,168 @@
+// Leveled, buffered console logging for the EMCal QA plotting macros
+
+/*
+   LOGGING OVERVIEW:
+   RunLog collects the console output of one unit of work (usually one run) in memory and writes it out
+   in a single call, instead of flushing std::cout on every line. Lines are written to Info(), Debug() or
+   Error(); lines above the configured LogLevel are discarded without being formatted into the buffer.
+   PlotSummaryLog gathers one machine-readable record per run and histogram (status, nEvents, time)
+   and writes them as JSON lines for monitoring.
+*/
+
+#ifndef QA_LOGGER_H
+#define QA_LOGGER_H
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Console verbosity: quiet prints problems only, info the per-run progress, debug every processing step
+enum class LogLevel { kQuiet = 0, kInfo = 1, kDebug = 2 };
+
+// Verbosity from its number (0 = quiet, 1 = info, 2 = debug), for command line entry points
+inline LogLevel LogLevelFromInt(int verbosity) {
+    if (verbosity <= 0) return LogLevel::kQuiet;
+    if (verbosity == 1) return LogLevel::kInfo;
+    return LogLevel::kDebug;
+}
+
+// Stream that drops everything written to it (one per thread, since its state is modified on write)
+inline std::ostream& NullStream() {
+    thread_local std::ostream null(nullptr);
+    return null;
+}
+
+// Buffered log for one run, flushed to the console in one piece
+class RunLog {
+public:
+    explicit RunLog(LogLevel level = LogLevel::kInfo) : level_(level) {}
+
+    std::ostream& Info() { return level_ >= LogLevel::kInfo ? buffer_ : NullStream(); }
+    std::ostream& Debug() { return level_ >= LogLevel::kDebug ? buffer_ : NullStream(); }
+    std::ostream& Error() { return buffer_; }
+
+    LogLevel Level() const { return level_; }
+
+    // Write everything collected so far to out and empty the buffer
+    void Flush(std::ostream& out = std::cout) {
+        const std::string text = buffer_.str();
+        if (!text.empty()) {
+            out << text << std::flush;
+            buffer_.str("");
+        }
+    }
+
+private:
+    LogLevel level_;
+    std::ostringstream buffer_;
+};
+
+// Struct to hold the outcome of one plot, for the machine-readable summary
+struct PlotSummary {
+    std::string run;        // Run number
+    std::string histName;   // Histogram plotted
+    std::string status;     // ok, skipped, file_error or hist_error
+    double nEvents;         // Number of events used for normalization (-1 if unknown)
+    double ms;              // Wall time spent on the plot in milliseconds
+    std::string error;      // Reason of a file_error or hist_error, empty otherwise
+};
+
+// Thread-safe collection of plot summaries
+class PlotSummaryLog {
+public:
+    void Add(const PlotSummary& summary) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_.push_back(summary);
+    }
+
+    // Write all records as JSON lines to path ("-" = standard output)
+    void Write(const std::string& path) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ofstream file;
+        if (path != "-") {
+            file.open(path);
+            if (!file) {
+                std::cout << "Summary issue: cannot write " << path << std::endl;
+                return;
+            }
+        }
+        std::ostream& out = (path == "-") ? std::cout : file;
+        
+        // Records arrive in completion order when runs are processed in parallel; write them by run
+        std::vector<PlotSummary> sorted(records_);
+        std::stable_sort(sorted.begin(), sorted.end(), [](const PlotSummary& a, const PlotSummary& b) { return a.run < b.run; });
+        for (const auto& r : sorted) {
+            out << "{\"run\":\"" << JsonEscape(r.run) << "\",\"hist\":\"" << JsonEscape(r.histName) << "\",\"status\":\"" << r.status
+                << "\",\"nEvents\":" << (long long)r.nEvents << ",\"ms\":" << r.ms;
+            if (!r.error.empty()) {
+                out << ",\"error\":\"" << JsonEscape(r.error) << "\"";
+            }
+            out << "}\n";
+        }
+        out << std::flush;
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_.clear();
+    }
+
+    // Text as the contents of a JSON string: quotes, backslashes and control characters escaped
+    // (error messages carry file paths and ROOT's own wording, which may contain any of them)
+    static std::string JsonEscape(const std::string& text) {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char c : text) {
+            switch (c) {
+                case '"': escaped += "\\\""; break;
+                case '\\': escaped += "\\\\"; break;
+                case '\n': escaped += "\\n"; break;
+                case '\r': escaped += "\\r"; break;
+                case '\t': escaped += "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20) {
+                        char code[8];
+                        std::snprintf(code, sizeof(code), "\\u%04x", (unsigned)(unsigned char)c);
+                        escaped += code;
+                    } else {
+                        escaped += c;
+                    }
+            }
+        }
+        return escaped;
+    }
+
+    // List every failed plot (file_error or hist_error) with its reason; prints nothing if all succeeded
+    void PrintFailures(std::ostream& out = std::cout) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<const PlotSummary*> failed;
+        for (const auto& r : records_) {
+            if (r.status == "file_error" || r.status == "hist_error") {
+                failed.push_back(&r);
+            }
+        }
+        if (failed.empty()) {
+            return;
+        }
+        out << failed.size() << " of " << records_.size() << " plots failed:\n";
+        for (const PlotSummary* r : failed) {
+            out << "  run " << r->run << " " << r->histName << ": " << r->status;
+            if (!r->error.empty()) {
+                out << " (" << r->error << ")";
+            }
+            out << "\n";
+        }
+        out << std::flush;
+    }
+
+private:
+    std::vector<PlotSummary> records_;
+    mutable std::mutex mutex_;
+};
+
+#endif // QA_LOGGER_H
@@ -0,0 +1,127 @@
+// Per-run normalization factors for the EMCal QA plotting macros
+
+/*
+   NORMALIZATION OVERVIEW:
+   Every plotted histogram is scaled by 1 / (nEvents * sebCount), where nEvents is the entry count of the
+   run's hNClusters histogram (filled once per event) and sebCount comes from the run catalog.
+   NormalizationTable computes that factor once per run, the first time any histogram of the run is
+   normalized, and hands the same entry to every later histogram, plotter pass and worker thread.
+   The product is formed in floating point, so large runs cannot overflow it.
+   The table is a flat array of (run id, normalization) records sorted by run id, so lookups are binary
+   searches and the CSV lists the runs in run order.
+*/
+
+#ifndef QA_NORMALIZATION_H
+#define QA_NORMALIZATION_H
+
+#include <TH1F.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "QARunCache.h"
+#include "QARunCatalog.h"
+
+// Struct to hold the normalization of a single run
+struct RunNormalization {
+    double nEvents = -1;    // Entries of hNClusters, -1 if unknown
+    int sebCount = 0;       // Count of Sub Event Buffers (SEBs) for the run
+    double scale = 0;       // 1 / (nEvents * sebCount), 0 if either is missing
+
+    RunNormalization() = default;
+    RunNormalization(double events, int sebs) : nEvents(events), sebCount(sebs) {
+        if (nEvents > 0 && sebCount > 0) {
+            scale = 1.0 / (nEvents * (double)sebCount);
+        }
+    }
+
+    bool IsValid() const { return scale > 0; }
+};
+
+// Scale a histogram by its run's normalization (left unchanged if the event or SEB count is missing)
+inline void ApplyNormalization(TH1F* h, const RunNormalization& norm) {
+    if (norm.IsValid()) {
+        h->Scale(norm.scale);
+    }
+}
+
+// Thread-safe table of run -> normalization, filled from the shared run cache on first use
+class NormalizationTable {
+public:
+
+    // Normalization of one catalog run; its event count is taken from the cache (reading the run if needed) only once
+    RunNormalization Get(const RunInfo& info) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = LowerBound(info.id);
+            if (it != table_.end() && it->id == info.id && it->norm.sebCount == info.sebCount) {
+                return it->norm;
+            }
+        }
+        RunNormalization norm(RunHistCache::Instance().GetRun(info.run).nEvents, info.sebCount);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = LowerBound(info.id);
+        if (it != table_.end() && it->id == info.id) {
+            it->norm = norm;
+        } else {
+            table_.insert(it, {info.id, norm});
+        }
+        return norm;
+    }
+
+    // Compute the normalization of every run in the catalog up front, sorting the table once at the end
+    void Build(const RunCatalog& catalog) {
+        std::vector<Record> built;
+        built.reserve(catalog.Size());
+        for (const auto& info : catalog) {
+            built.push_back({info.id, RunNormalization(RunHistCache::Instance().GetRun(info.run).nEvents, info.sebCount)});
+        }
+        std::sort(built.begin(), built.end(), [](const Record& a, const Record& b) { return a.id < b.id; });
+        std::lock_guard<std::mutex> lock(mutex_);
+        table_.swap(built);
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        table_.clear();
+    }
+
+    size_t Size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return table_.size();
+    }
+
+    // One line per run: run,nEvents,sebCount,scale
+    void WriteCSV(const std::string& path) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "Normalization issue: cannot write " << path << std::endl;
+            return;
+        }
+        out.precision(10);
+        out << "run,nEvents,sebCount,scale\n";
+        for (const auto& record : table_) {
+            out << record.id << "," << (long long)record.norm.nEvents << "," << record.norm.sebCount << "," << record.norm.scale << "\n";
+        }
+    }
+
+private:
+    // Struct to hold one row of the table
+    struct Record {
+        int id;                 // Run number
+        RunNormalization norm;
+    };
+
+    std::vector<Record> table_;     // Sorted by run id
+    mutable std::mutex mutex_;
+
+    std::vector<Record>::iterator LowerBound(int id) {
+        return std::lower_bound(table_.begin(), table_.end(), id, [](const Record& record, int value) { return record.id < value; });
+    }
+};
+
+#endif // QA_NORMALIZATION_H
@@ -0,0 +1,123 @@
+// Manifest of already rendered plots, used to skip plots whose inputs and settings have not changed
+
+/*
+   MANIFEST OVERVIEW:
+   Every output directory gets a small text file (.qa_plot_manifest) with one line per plot:
+       <plot file name> <TAB> <stamp>
+   The stamp combines the input qa.root's size and modification time (or its MD5 checksum) with the plot
+   settings that went into the image (normalization, cuts, refill, display binning, format and compression,
+   title and axis labels). A plot is up to date when its file still exists and the stamp
+   recorded for it matches the stamp the current settings would produce.
+*/
+
+#ifndef QA_PLOT_MANIFEST_H
+#define QA_PLOT_MANIFEST_H
+
+#include <TSystem.h>
+#include <TMD5.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class PlotManifest {
+public:
+
+    // Use the MD5 checksum of the input file instead of its size and modification time
+    void SetUseChecksum(bool useChecksum) { useChecksum_ = useChecksum; }
+
+    // Stamp describing the current state of an input file ("" if the file cannot be found)
+    std::string InputStamp(const std::string& inputPath) const {
+        FileStat_t stat;
+        if (gSystem->GetPathInfo(inputPath.c_str(), stat) != 0) {
+            return "";
+        }
+        if (useChecksum_) {
+            TMD5 *md5 = TMD5::FileChecksum(inputPath.c_str());
+            std::string sum = md5 ? md5->AsString() : "";
+            delete md5;
+            return "md5:" + sum;
+        }
+        return "size:" + std::to_string(stat.fSize) + ",mtime:" + std::to_string(stat.fMtime);
+    }
+
+    // Whether the plot at outputPath exists and was produced from the given stamp
+    bool IsCurrent(const std::string& outputPath, const std::string& stamp) {
+        if (stamp.empty() || gSystem->AccessPathName(outputPath.c_str())) {
+            return false;   // AccessPathName returns true when the file does NOT exist
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        DirManifest& dir = GetDir(outputPath);
+        auto it = dir.entries.find(FileName(outputPath));
+        return it != dir.entries.end() && it->second == stamp;
+    }
+
+    // Record that the plot at outputPath was just produced from the given stamp
+    void Update(const std::string& outputPath, const std::string& stamp) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        DirManifest& dir = GetDir(outputPath);
+        dir.entries[FileName(outputPath)] = stamp;
+        dir.dirty = true;
+    }
+
+    // Write every modified manifest back next to its plots
+    void Save() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& dirEntry : dirs_) {
+            DirManifest& dir = dirEntry.second;
+            if (!dir.dirty) {
+                continue;
+            }
+            std::string path = dirEntry.first + kManifestName;
+            std::ofstream out(path);
+            if (!out) {
+                std::cout << "Manifest issue: cannot write " << path << std::endl;
+                continue;
+            }
+            for (const auto& entry : dir.entries) {
+                out << entry.first << '\t' << entry.second << '\n';
+            }
+            dir.dirty = false;
+        }
+    }
+
+private:
+    // Struct to hold the manifest of a single output directory
+    struct DirManifest {
+        std::unordered_map<std::string, std::string> entries;   // Plot file name -> stamp
+        bool dirty = false;                                     // Modified since it was read
+    };
+
+    static constexpr const char* kManifestName = ".qa_plot_manifest";
+
+    bool useChecksum_ = false;
+    std::unordered_map<std::string, DirManifest> dirs_;     // Keyed by output directory (with trailing '/')
+    std::mutex mutex_;
+
+    // Returns the manifest of the directory containing outputPath, reading it on first use
+    DirManifest& GetDir(const std::string& outputPath) {
+        std::string dirName = outputPath.substr(0, outputPath.find_last_of('/') + 1);
+        auto it = dirs_.find(dirName);
+        if (it != dirs_.end()) {
+            return it->second;
+        }
+
+        DirManifest& dir = dirs_[dirName];
+        std::ifstream in(dirName + kManifestName);
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t tab = line.find('\t');
+            if (tab != std::string::npos) {
+                dir.entries[line.substr(0, tab)] = line.substr(tab + 1);
+            }
+        }
+        return dir;
+    }
+
+    static std::string FileName(const std::string& path) {
+        return path.substr(path.find_last_of('/') + 1);
+    }
+};
+
+#endif // QA_PLOT_MANIFEST_H
@@ -0,0 +1,197 @@
+// Image output for the EMCal QA plotting macros
+
+/*
+   PLOT WRITER OVERVIEW:
+   PlotWriter saves a finished canvas in the configured format: PNG (default), or a vector format such as
+   PDF or SVG. PNGs can be written with a chosen compression level and, in asynchronous mode, encoded on
+   background threads: the plotting thread only rasterizes the canvas into a TImage and queues it, so the
+   plot loop moves on to the next histogram while earlier images are still being compressed.
+   In multi-page mode every plot of a histogram goes onto the pages of a single PDF document instead of
+   a file of its own, which replaces thousands of small files with one document per histogram.
+
+   The queue is bounded: when the encoders fall behind, Save() waits for a free slot instead of piling
+   up raw images in memory. Call Flush() before depending on the files being on disk.
+
+   THREADS:
+   Saving goes through ROOT's global output state (gVirtualPS for SaveAs/Print, TImageDump and the image
+   library for FromPad and WriteImage), which ROOT::EnableThreadSafety() does not protect. Every such call,
+   from any writer, plotting thread or encoder, is therefore made under one process-wide lock: worker threads
+   still draw their canvases in parallel, but save and encode one image at a time.
+*/
+
+#ifndef QA_PLOT_WRITER_H
+#define QA_PLOT_WRITER_H
+
+#include <TCanvas.h>
+#include <TImage.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class PlotWriter {
+public:
+    PlotWriter() = default;
+    PlotWriter(const PlotWriter&) = delete;
+    PlotWriter& operator=(const PlotWriter&) = delete;
+
+    // Waits for every queued image and stops the encoder threads
+    ~PlotWriter() { StopEncoders(); }
+
+    // File format, as the file extension without the dot: png (default), pdf, svg, eps, ...
+    void SetFormat(const std::string& format) { format_ = format; }
+    const std::string& GetFormat() const { return format_; }
+
+    // PNG compression level from 0 (none) to 100 (smallest files); -1 keeps ROOT's default
+    void SetPngCompression(int level) { pngCompression_ = level; }
+    int GetPngCompression() const { return pngCompression_; }
+
+    // Encode PNGs on nEncoders background threads (requires ROOT::EnableThreadSafety())
+    void SetAsyncEncoding(bool async, unsigned nEncoders = 1) {
+        async_ = async;
+        nEncoders_ = std::max(1u, nEncoders);
+    }
+    bool IsAsync() const { return async_ && format_ == "png"; }
+
+    // One multi-page PDF document per histogram instead of one file per plot (forces the pdf format)
+    void SetMultiPage(bool multiPage) {
+        multiPage_ = multiPage;
+        if (multiPage_) {
+            format_ = "pdf";
+        }
+    }
+    bool IsMultiPage() const { return multiPage_; }
+
+    // Save the current content of canvas to path (its extension should be GetFormat())
+    // In multi-page mode the canvas is added as the next page of document instead
+    void Save(TCanvas* canvas, const std::string& path, const std::string& document = "") {
+        std::unique_lock<std::mutex> outputLock(OutputMutex());
+        if (multiPage_ && !document.empty()) {
+            // "[" opens a document without printing a page; ROOT keeps every open document by name
+            if (openDocuments_.insert(document).second) {
+                canvas->Print((document + "[").c_str());
+            }
+            canvas->Print(document.c_str());
+            return;
+        }
+        if (format_ != "png" || (!async_ && pngCompression_ < 0)) {
+            canvas->SaveAs(path.c_str());
+            return;
+        }
+
+        // Rasterize now (the canvas is reused for the next plot), compress now or on an encoder thread
+        TImage* image = TImage::Create();
+        image->FromPad(canvas);
+        if (!async_) {
+            Encode(image, path);
+            return;
+        }
+        // The encoders take the same lock, so it is not held while waiting for a queue slot
+        outputLock.unlock();
+        StartEncoders();
+        std::unique_lock<std::mutex> lock(mutex_);
+        queueChanged_.wait(lock, [this]() { return queue_.size() < 2 * nEncoders_; });
+        queue_.emplace_back(image, path);
+        lock.unlock();
+        queueChanged_.notify_all();
+    }
+
+    // Close every open multi-page document; canvas is only used to issue the closing Print()
+    void ClosePages(TCanvas* canvas) {
+        std::lock_guard<std::mutex> outputLock(OutputMutex());
+        for (const auto& document : openDocuments_) {
+            canvas->Print((document + "]").c_str());
+        }
+        openDocuments_.clear();
+    }
+
+    // Wait until every queued image has been written
+    void Flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queueChanged_.wait(lock, [this]() { return queue_.empty() && nEncoding_ == 0; });
+    }
+
+    // Flush and join the encoder threads; they are started again by the next asynchronous Save()
+    // (needed before fork(), whose children would otherwise wait on threads that only exist in the parent)
+    void StopEncoders() {
+        Flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        queueChanged_.notify_all();
+        for (auto& encoder : encoders_) {
+            encoder.join();
+        }
+        encoders_.clear();
+        stop_ = false;
+    }
+
+private:
+    std::string format_ = "png";
+    int pngCompression_ = -1;
+    bool async_ = false;
+    unsigned nEncoders_ = 1;
+    bool multiPage_ = false;
+    std::set<std::string> openDocuments_;   // Multi-page documents with at least one page written
+
+    // Encoder queue: rasterized images waiting to be compressed and written, guarded by mutex_
+    std::deque<std::pair<TImage*, std::string>> queue_;
+    std::vector<std::thread> encoders_;
+    unsigned nEncoding_ = 0;
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable queueChanged_;
+
+    // Lock around every use of ROOT's global output state (see THREADS above), shared by all writers
+    static std::mutex& OutputMutex() {
+        static std::mutex outputMutex;
+        return outputMutex;
+    }
+
+    // Compress and write image, then free it; the caller holds OutputMutex()
+    void Encode(TImage* image, const std::string& path) const {
+        if (pngCompression_ >= 0) {
+            image->SetImageCompression(pngCompression_);
+        }
+        image->WriteImage(path.c_str(), TImage::kPng);
+        delete image;
+    }
+
+    void StartEncoders() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (encoders_.size() < nEncoders_) {
+            encoders_.emplace_back([this]() { EncoderLoop(); });
+        }
+    }
+
+    void EncoderLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            queueChanged_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            auto job = queue_.front();
+            queue_.pop_front();
+            nEncoding_++;
+            lock.unlock();
+            queueChanged_.notify_all();
+            {
+                std::lock_guard<std::mutex> outputLock(OutputMutex());
+                Encode(job.first, job.second);
+            }
+            lock.lock();
+            nEncoding_--;
+            queueChanged_.notify_all();
+        }
+    }
+};
+
+#endif // QA_PLOT_WRITER_H
@@ -0,0 +1,116 @@
+// Ratio panels for the EMCal QA overlays
+
+/*
+   RATIO OVERVIEW:
+   The ratio of a run to its reference (another run, or the average of the overlaid runs) is computed
+   from the normalized histograms already drawn on the overlay, so no file is read again. Both the
+   average and the ratios are formed in single passes over the raw bin arrays of the histograms
+   (contents, then Sumw2 errors), which the compiler can vectorize, instead of one GetBinContent /
+   SetBinContent call per bin. The arrays are only combined after SameBinning() confirms that every
+   histogram has the same cells; a run with a different binning (e.g. a reprocessed qa.root) is left out.
+   The ratios are formed at full resolution and only merged for display afterwards.
+*/
+
+#ifndef QA_RATIO_H
+#define QA_RATIO_H
+
+#include <TH1F.h>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "QACompare.h"
+
+// What the runs of an overlay are divided by in the ratio panel
+enum class RatioReference { kNone = 0, kRun = 1, kAverage = 2 };
+
+// Bin-by-bin mean of hists written into mean; errors are those of the mean when Sumw2 is filled
+// Histograms whose binning differs from mean's are skipped with a warning; returns the number averaged
+inline int FillAverage(const std::vector<const TH1F*>& hists, TH1F* mean) {
+    const int n = mean->GetNcells();
+    Float_t* m = mean->GetArray();
+    for (int i = 0; i < n; i++) {
+        m[i] = 0;
+    }
+    std::vector<const TH1F*> used;
+    for (const TH1F* h : hists) {
+        if (SameBinning(h, mean)) {
+            used.push_back(h);
+        } else {
+            std::cout << "Ratio issue: " << h->GetName() << " has a different binning, left out of the average" << std::endl;
+        }
+    }
+    if (used.empty()) {
+        return 0;
+    }
+    bool errors = true;
+    for (const TH1F* h : used) {
+        const Float_t* a = h->GetArray();
+        for (int i = 0; i < n; i++) {
+            m[i] += a[i];
+        }
+        errors = errors && h->GetSumw2N() == n;
+    }
+    const Float_t norm = 1.0f / used.size();
+    for (int i = 0; i < n; i++) {
+        m[i] *= norm;
+    }
+
+    // The variance of the mean is the sum of the variances over n^2
+    if (errors) {
+        if (mean->GetSumw2N() != n) {
+            mean->Sumw2();
+        }
+        Double_t* v = mean->GetSumw2()->GetArray();
+        for (int i = 0; i < n; i++) {
+            v[i] = 0;
+        }
+        for (const TH1F* h : used) {
+            const Double_t* e = h->GetSumw2()->GetArray();
+            for (int i = 0; i < n; i++) {
+                v[i] += e[i];
+            }
+        }
+        const Double_t norm2 = (Double_t)norm * norm;
+        for (int i = 0; i < n; i++) {
+            v[i] *= norm2;
+        }
+    }
+    mean->SetEntries(used.front()->GetEntries());
+    return (int)used.size();
+}
+
+// Bin-by-bin ratio num / den written into ratio; bins with an empty denominator are set to 0
+// Errors are propagated from both Sumw2 arrays as for uncorrelated histograms when both are filled
+// Returns false, leaving ratio untouched, unless num, den and ratio all have the same binning
+inline bool FillRatio(const TH1F* num, const TH1F* den, TH1F* ratio) {
+    if (!SameBinning(num, den) || !SameBinning(num, ratio)) {
+        return false;
+    }
+    const int n = ratio->GetNcells();
+    const Float_t* a = num->GetArray();
+    const Float_t* b = den->GetArray();
+    Float_t* r = ratio->GetArray();
+    for (int i = 0; i < n; i++) {
+        r[i] = b[i] != 0 ? a[i] / b[i] : 0.0f;
+    }
+
+    if (num->GetSumw2N() == n && den->GetSumw2N() == n) {
+        if (ratio->GetSumw2N() != n) {
+            ratio->Sumw2();
+        }
+        const Double_t* ea = num->GetSumw2()->GetArray();
+        const Double_t* eb = den->GetSumw2()->GetArray();
+        Double_t* er = ratio->GetSumw2()->GetArray();
+        // var(a / b) = (var(a) + r^2 var(b)) / b^2
+        for (int i = 0; i < n; i++) {
+            const Double_t b2 = (Double_t)b[i] * b[i];
+            const Double_t r2 = (Double_t)r[i] * r[i];
+            er[i] = b2 > 0 ? (ea[i] + r2 * eb[i]) / b2 : 0.0;
+        }
+    }
+    ratio->SetEntries(num->GetEntries());
+    return true;
+}
+
+#endif // QA_RATIO_H
@@ -0,0 +1,52 @@
+// Display rebinning for the EMCal QA plotting macros
+
+/*
+   REBIN OVERVIEW:
+   Very fine histograms (10^5 bins) cost far more to draw and encode than the canvas can show. Before a
+   histogram is drawn, DownsampleForDisplay() merges whole groups of adjacent bins so that at most
+   maxBins remain; the new edges are taken from the original axis, so no bin is split. Only the drawn copy
+   is rebinned, after normalization and cuts: statistics and comparisons use the full-resolution
+   histograms, and the rebinned copy keeps the original's moments for its stats box. Ratios are intensive,
+   so they are merged with average = true: each drawn bin is the mean of the fine bins it covers.
+*/
+
+#ifndef QA_REBIN_H
+#define QA_REBIN_H
+
+#include <TH1F.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// Returns hist itself if it has at most maxBins bins (or maxBins <= 0), otherwise a detached copy with at most
+// maxBins merged bins that replaces it: hist is deleted, and the copy keeps its name, style and statistics
+// average divides every merged bin (and its error) by the number of bins merged, for ratios instead of counts
+inline TH1F* DownsampleForDisplay(TH1F* hist, int maxBins, bool average = false) {
+    const int nBins = hist->GetNbinsX();
+    if (maxBins <= 0 || nBins <= maxBins) {
+        return hist;
+    }
+    const int group = (nBins + maxBins - 1) / maxBins;
+    const TAxis* axis = hist->GetXaxis();
+    std::vector<double> edges;
+    for (int bin = 1; bin <= nBins; bin += group) {
+        edges.push_back(axis->GetBinLowEdge(bin));
+    }
+    edges.push_back(axis->GetBinUpEdge(nBins));
+
+    const std::string name = hist->GetName();
+    TH1F* display = (TH1F*)hist->Rebin((Int_t)edges.size() - 1, (name + "_display").c_str(), edges.data());
+    display->SetDirectory(nullptr);
+    if (average) {
+        for (int bin = 1; bin <= display->GetNbinsX(); bin++) {
+            const int merged = std::min(group, nBins - (bin - 1) * group);
+            display->SetBinContent(bin, display->GetBinContent(bin) / merged);
+            display->SetBinError(bin, display->GetBinError(bin) / merged);
+        }
+    }
+    delete hist;
+    display->SetName(name.c_str());
+    return display;
+}
+
+#endif // QA_REBIN_H
@@ -0,0 +1,895 @@
+// Shared per-run histogram cache for the EMCal QA plotting macros
+
+/*
+   CACHE OVERVIEW:
+   SinglePlotter and OverlayPlotter both read the same handful of histograms from every run's qa.root.
+   RunHistCache opens each run's file once, reads all QA histograms together with the hNClusters
+   event count in one go, keeps detached copies of them in memory and closes the file again.
+   The plotters then ask the cache for a private working copy of the histogram they need, so a full
+   session costs one TFile::Open per run no matter how many histograms or plotters use it.
+   The cache is safe to use from several worker threads (after ROOT::EnableThreadSafety()); files are
+   opened on the thread that first asks for a run, outside of the cache lock.
+
+   CONSOLIDATED CACHE FILE:
+   Consolidate() extracts every QA histogram, the hNClusters event count and the SEB count of all runs in a
+   catalog into a single file (by default <baseDir>/qa_consolidated.root), with one directory per run:
+       <run>/<histName>                 the QA histograms
+       <run>/nEvents, <run>/sebCount    TParameter<double> / TParameter<int>
+       <run>/keys                       TNamed listing every top-level key of the run's qa.root
+   When that file is present, the first request loads every run in it with one open; runs missing from it
+   are still read from their own qa.root. With SetStaleCheck(true), so are runs whose qa.root is newer than
+   the consolidated file (reprocessed since the consolidation); the check stats every run's qa.root, one
+   remote round trip each on xrootd/EOS, so it is off by default. Re-run the consolidation after adding or
+   reprocessing runs.
+   Files consolidated from different subsets of the runs (the partial files of sharded batch jobs) are
+   combined into one with MergeConsolidated(), which only copies run directories and opens no qa.root.
+
+   REMOTE INPUT:
+   The base directory may be a URL (e.g. root://eos.example.org//eos/qa/). Opens can be given a timeout and
+   retried with a growing delay, and the reason of a run that still cannot be read is kept in its entry
+   for the plotters to report. All keys a run needs (the QA histograms and hNClusters) are fetched with
+   a single vectored TFile::ReadBuffers call, i.e. one round trip instead of one per Get().
+
+   MEMORY BUDGET:
+   With SetMemoryBudget() the cached histograms are kept within a byte budget: every (run, histogram)
+   is tracked in least-recently-used order, and once the budget is exceeded the oldest ones are freed.
+   An evicted histogram stays known to its run and is read again (from the file it came from) the next
+   time it is asked for; the run's event count and key list are never evicted. With a budget, the
+   consolidated file only provides the runs' metadata up front and their histograms on demand; those
+   re-reads go through one handle on the consolidated file kept open for the session, so a miss reads the
+   keys and histograms of one run directory, not the whole file's header and key list again.
+   SetLazyLoading() gives the same metadata-only read of the consolidated file without a budget, for passes
+   that visit each run once and release it (the trend macro): only the runs being worked on hold histograms.
+   WithHist() pins the histogram it hands out and calls the reader outside the cache lock, so threads
+   working on different (or the same) histograms do not wait for each other; a pinned histogram is never
+   evicted, and one released while pinned is freed when its last reader is done.
+   Hits, misses, evictions and the resident bytes are reported by PrintStats().
+*/
+
+#ifndef QA_RUN_CACHE_H
+#define QA_RUN_CACHE_H
+
+#include <TFile.h>
+#include <TH1F.h>
+#include <TKey.h>
+#include <TCollection.h>
+#include <TDirectory.h>
+#include <TNamed.h>
+#include <TParameter.h>
+#include <TSystem.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include "QATiming.h"
+#include "QARunCatalog.h"
+
+class RunHistCache {
+public:
+
+    // Struct to hold everything read from a single run's qa.root
+    struct RunEntry {
+        bool fileOk = false;        // Whether qa.root could be opened at all
+        double nEvents = -1;        // Entries of hNClusters (filled once per event), -1 if missing
+        std::unordered_map<std::string, TH1F*> hists;   // Detached histograms, owned by the cache
+        std::unordered_set<std::string> keys;           // Names of every top-level object in the file
+        double openMs = 0;          // Time spent in TFile::Open
+        double getMs = 0;           // Time spent reading the histograms
+        long long bytesRead = 0;    // Bytes read from the file (TFile::GetBytesRead)
+        int attempts = 0;           // Opens tried before the file could be read (or before giving up)
+        std::string error;          // Why the file could not be read, empty if it was
+        std::string source;         // File the histograms are (re)read from
+        std::string sourceDir;      // Directory of the run inside source, empty for the top directory
+        std::unordered_set<std::string> unloaded;       // Histograms in source that are not in memory (evicted)
+    };
+
+    // Struct to hold the usage counters of the cache
+    struct CacheStats {
+        long long hits = 0;             // Histogram requests served from memory
+        long long misses = 0;           // Histogram requests that had to read a file
+        long long evictions = 0;        // Histograms freed to stay within the budget
+        long long residentBytes = 0;    // Approximate size of the histograms in memory
+        long long peakBytes = 0;        // Largest residentBytes so far
+        long long budgetBytes = 0;      // Memory budget, 0 = unlimited
+        double HitRate() const { return hits + misses > 0 ? (double)hits / (hits + misses) : 0.0; }
+    };
+
+    // Single cache instance shared by every plotter in the session
+    // Macros built by QALoad.C (QA_CORE_LIBRARY defined) take it from the QA core library they are linked against,
+    // so there is exactly one definition in the process; a macro loaded on its own keeps the inline definition
+#ifdef QA_CORE_LIBRARY
+    static RunHistCache& Instance();
+#else
+    static RunHistCache& Instance() {
+        // Intentionally never deleted: avoids destruction order issues with ROOT at exit
+        static RunHistCache* cache = new RunHistCache();
+        return *cache;
+    }
+#endif
+
+    /*
+     ENSURE TO CHANGE PATH TO ROOT FILES HERE (or call SetBaseDir before plotting)
+     A local directory or a remote URL such as root://host//path/ (with trailing '/')
+     */
+    void SetBaseDir(const std::string& baseDir) { baseDir_ = baseDir; }
+    const std::string& GetBaseDir() const { return baseDir_; }
+
+    // Give up on an open after timeoutSeconds (0 = ROOT's default, no timeout)
+    void SetOpenTimeout(int timeoutSeconds) { openTimeout_ = timeoutSeconds; }
+
+    // Retry a failed open up to retries times, waiting delayMs, 2*delayMs, ... in between
+    void SetOpenRetries(int retries, int delayMs = 1000) {
+        openRetries_ = retries;
+        retryDelayMs_ = delayMs;
+    }
+
+    // Fetch every key a run needs in one vectored read (default) instead of one read per histogram
+    void SetVectoredReads(bool vectored) { vectoredReads_ = vectored; }
+
+    // Keep the cached histograms under budgetBytes (0 = unlimited), evicting the least recently used ones
+    void SetMemoryBudget(long long budgetBytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budgetBytes_ = budgetBytes;
+        EvictOverBudget();
+    }
+
+    // Before loading the consolidated file, stat every run's qa.root and read the runs reprocessed since the
+    // consolidation from their qa.root instead (off by default: one stat, remote or not, per run)
+    void SetStaleCheck(bool check) {
+        std::lock_guard<std::mutex> consolidatedLock(consolidatedMutex_);
+        staleCheck_ = check;
+    }
+
+    // Read only the runs' metadata from the consolidated file and each run's histograms when first asked for
+    // (always the case under a memory budget); takes effect the next time the consolidated file is read
+    void SetLazyLoading(bool lazy) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lazyLoading_ = lazy;
+    }
+
+    CacheStats GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        CacheStats stats(stats_);
+        stats.residentBytes = residentBytes_;
+        stats.budgetBytes = budgetBytes_;
+        return stats;
+    }
+
+    // One line with the hit rate, evictions and resident bytes, for the end of a timing summary
+    void PrintStats(std::ostream& out = std::cout) const {
+        const CacheStats stats = GetStats();
+        out << "cache: " << stats.hits << " hits, " << stats.misses << " misses (hit rate " << std::fixed << std::setprecision(1)
+            << 100.0 * stats.HitRate() << "%), " << stats.evictions << " evictions, " << stats.residentBytes / 1024 << " kB resident (peak "
+            << stats.peakBytes / 1024 << " kB";
+        if (stats.budgetBytes > 0) {
+            out << ", budget " << stats.budgetBytes / 1024 << " kB";
+        }
+        out << ")\n";
+        out.unsetf(std::ios::fixed);
+        out << std::setprecision(6) << std::flush;
+    }
+
+    // Full path of the qa.root file for a given run
+    std::string GetFilePath(const std::string& run) const {
+        return baseDir_ + run + "/qa.root";
+    }
+
+    // Consolidated cache file read before the per-run files (empty = <baseDir>/qa_consolidated.root, "none" = never)
+    void SetConsolidatedFile(const std::string& path) { consolidatedFile_ = path; }
+    std::string GetConsolidatedPath() const {
+        return consolidatedFile_.empty() ? baseDir_ + "qa_consolidated.root" : consolidatedFile_;
+    }
+
+    // Write the consolidated cache file for every run in the catalog, reading each run's qa.root one at a time
+    // Returns the number of runs written; the file is replaced atomically, so readers never see a partial file
+    int Consolidate(const RunCatalog& catalog, const std::string& path = "") {
+        const std::string outPath = path.empty() ? GetConsolidatedPath() : path;
+        const std::string tmpPath = outPath + ".tmp";
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            names = histNames_;
+        }
+
+        TFile *out = TFile::Open(tmpPath.c_str(), "RECREATE");
+        if (!out || out->IsZombie()) {
+            std::cout << "Consolidation issue: cannot write " << tmpPath << std::endl;
+            delete out;
+            return 0;
+        }
+
+        int nWritten = 0;
+        for (const auto& info : catalog) {
+            RunEntry entry = LoadRun(info.run, names);
+            if (!entry.fileOk) {
+                std::cout << "File issue for run: " << info.run << ", not consolidated" << std::endl;
+                continue;
+            }
+            TDirectory *dir = out->mkdir(info.run.c_str());
+            for (const auto& histEntry : entry.hists) {
+                dir->WriteTObject(histEntry.second, histEntry.first.c_str());
+                delete histEntry.second;
+            }
+            TParameter<double> nEvents("nEvents", entry.nEvents);
+            TParameter<int> sebCount("sebCount", info.sebCount);
+            std::string keyList;
+            for (const auto& key : entry.keys) {
+                keyList += (keyList.empty() ? "" : ",") + key;
+            }
+            TNamed keys("keys", keyList.c_str());
+            dir->WriteTObject(&nEvents);
+            dir->WriteTObject(&sebCount);
+            dir->WriteTObject(&keys);
+            nWritten++;
+        }
+        out->Close();
+        delete out;
+
+        if (gSystem->Rename(tmpPath.c_str(), outPath.c_str()) != 0) {
+            std::cout << "Consolidation issue: cannot move " << tmpPath << " to " << outPath << std::endl;
+            return 0;
+        }
+        std::cout << "Consolidated " << nWritten << " runs into " << outPath << std::endl;
+        return nWritten;
+    }
+
+    // Combine consolidated files of disjoint run subsets into one consolidated file at outPath
+    // A run found in several inputs is taken from the first one; runs (optional) receives every run written
+    // Returns the number of runs written; like Consolidate() the output is replaced atomically
+    static int MergeConsolidated(const std::vector<std::string>& inputs, const std::string& outPath, std::vector<std::string>* runs = nullptr) {
+        const std::string tmpPath = outPath + ".tmp";
+        TFile *out = TFile::Open(tmpPath.c_str(), "RECREATE");
+        if (!out || out->IsZombie()) {
+            std::cout << "Merge issue: cannot write " << tmpPath << std::endl;
+            delete out;
+            return 0;
+        }
+
+        std::unordered_set<std::string> written;
+        for (const auto& input : inputs) {
+            TFile *in = TFile::Open(input.c_str());
+            if (!in || in->IsZombie()) {
+                std::cout << "Merge issue: cannot read " << input << ", skipped" << std::endl;
+                delete in;
+                continue;
+            }
+            TIter nextRun(in->GetListOfKeys());
+            while (TKey *runKey = (TKey*)nextRun()) {
+                TDirectory *dir = in->GetDirectory(runKey->GetName());
+                if (!dir || !written.insert(runKey->GetName()).second) {
+                    continue;
+                }
+                TDirectory *outDir = out->mkdir(runKey->GetName());
+                TIter nextKey(dir->GetListOfKeys());
+                while (TKey *key = (TKey*)nextKey()) {
+                    TObject *obj = key->ReadObj();
+                    if (obj) {
+                        outDir->WriteTObject(obj, key->GetName());
+                        delete obj;
+                    }
+                }
+                if (runs) {
+                    runs->push_back(runKey->GetName());
+                }
+            }
+            in->Close();
+            delete in;
+        }
+        out->Close();
+        delete out;
+
+        if (gSystem->Rename(tmpPath.c_str(), outPath.c_str()) != 0) {
+            std::cout << "Merge issue: cannot move " << tmpPath << " to " << outPath << std::endl;
+            return 0;
+        }
+        std::cout << "Merged " << written.size() << " runs from " << inputs.size() << " files into " << outPath << std::endl;
+        return (int)written.size();
+    }
+
+    // File a run's histograms come from: the consolidated file if it holds the run (and, with SetStaleCheck, the
+    // run's qa.root is not newer), else the run's qa.root
+    // Does not read the run itself, so it is cheap enough for deciding whether the run has to be plotted at all
+    std::string GetSourcePath(const std::string& run) {
+        LoadConsolidated();
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = runs_.find(run);
+        return it != runs_.end() && !it->second.source.empty() ? it->second.source : GetFilePath(run);
+    }
+
+    // Returns the cached entry for a run, reading its file the first time the run is requested
+    // loadedNow (optional) is set to whether this call read the file
+    const RunEntry& GetRun(const std::string& run, bool* loadedNow = nullptr) {
+        if (loadedNow) {
+            *loadedNow = false;
+        }
+        LoadConsolidated();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = runs_.find(run);
+            if (it != runs_.end()) {
+                return it->second;
+            }
+        }
+        
+        // Read the file without holding the lock so other threads can load their runs meanwhile
+        RunEntry loaded = LoadRun(run);
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        // try_emplace leaves loaded untouched if the run is already present
+        auto inserted = runs_.try_emplace(run, std::move(loaded));
+        if (!inserted.second) {
+            // Another thread loaded the same run first; keep its entry
+            for (auto& histEntry : loaded.hists) {
+                delete histEntry.second;
+            }
+        } else {
+            for (const auto& histEntry : inserted.first->second.hists) {
+                Track(run, histEntry.first, histEntry.second);
+            }
+            EvictOverBudget();
+            if (loadedNow) {
+                *loadedNow = true;
+            }
+        }
+        return inserted.first->second;
+    }
+
+    // Returns a private, detached copy of a cached histogram (nullptr if it is not in the file)
+    // The caller owns the copy and may scale or modify it freely
+    TH1F* CloneHist(const std::string& run, const std::string& histName, const std::string& newName) {
+        TH1F* copy = nullptr;
+        WithHist(run, histName, [&copy, &newName](const TH1F& hist) {
+            copy = (TH1F*)hist.Clone(newName.c_str());
+            copy->SetDirectory(nullptr);
+        });
+        return copy;
+    }
+
+    // Call reader with a cached histogram while it is guaranteed to stay in memory (no copy is made)
+    // Returns false, without calling reader, if the histogram is not in the run's file
+    template <class Reader>
+    bool WithHist(const std::string& run, const std::string& histName, Reader reader) {
+        bool loadedNow = false;
+        GetRun(run, &loadedNow);
+        
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto it = runs_.find(run);
+        if (it == runs_.end() || !it->second.fileOk) {
+            return false;
+        }
+        
+        // Histograms outside the default list are read (once) on request, evicted ones again
+        const bool newName = std::find(histNames_.begin(), histNames_.end(), histName) == histNames_.end();
+        if (newName) {
+            histNames_.push_back(histName);
+            // The other cached runs predate the request, so they read it on first use too
+            for (auto& runEntry : runs_) {
+                if (runEntry.second.fileOk && !runEntry.second.hists.count(histName)) {
+                    runEntry.second.unloaded.insert(histName);
+                }
+            }
+        }
+        bool missed = loadedNow;
+        if (newName || it->second.unloaded.count(histName)) {
+            // Everything of the run that is not in memory comes back in the same read, outside the lock
+            std::vector<std::string> names;
+            for (const auto& name : histNames_) {
+                if (name == histName || it->second.unloaded.count(name)) {
+                    names.push_back(name);
+                }
+            }
+            const std::string source = it->second.source;
+            const std::string sourceDir = it->second.sourceDir;
+            lock.unlock();
+            std::unordered_map<std::string, TH1F*> read = ReadSource(source, sourceDir, names);
+            lock.lock();
+            it = runs_.find(run);
+            if (it == runs_.end()) {
+                for (auto& histEntry : read) {
+                    delete histEntry.second;
+                }
+                return false;
+            }
+            AddHists(run, it->second, read);
+            // Names the file does not have are not looked for again
+            for (const auto& name : names) {
+                it->second.unloaded.erase(name);
+            }
+            missed = true;
+        }
+        if (missed) {
+            stats_.misses++;
+        } else {
+            stats_.hits++;
+        }
+        
+        auto hit = it->second.hists.find(histName);
+        if (hit == it->second.hists.end()) {
+            return false;
+        }
+        Touch(run, histName);
+        
+        // The pin keeps the histogram alive (not evicted, not freed) while reader runs without the lock
+        TH1F* hist = hit->second;
+        pins_[hist]++;
+        lock.unlock();
+        reader((const TH1F&)*hist);
+        lock.lock();
+        Unpin(hist);
+        EvictOverBudget();
+        return true;
+    }
+
+    // Frees one histogram type from every cached run once no plotter needs it anymore
+    // (a later request for it reads the run's file again)
+    void ReleaseHist(const std::string& histName) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& runEntry : runs_) {
+            auto hit = runEntry.second.hists.find(histName);
+            if (hit != runEntry.second.hists.end()) {
+                Untrack(runEntry.first, histName);
+                Discard(hit->second);
+                runEntry.second.hists.erase(hit);
+            }
+            runEntry.second.unloaded.erase(histName);
+        }
+        histNames_.erase(std::remove(histNames_.begin(), histNames_.end(), histName), histNames_.end());
+    }
+
+    // Frees one run and its histograms once it has been processed (a later request reads its file again)
+    // Any reference to the run's entry is invalid afterwards
+    void ReleaseRun(const std::string& run) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = runs_.find(run);
+        if (it == runs_.end()) {
+            return;
+        }
+        for (auto& histEntry : it->second.hists) {
+            Untrack(run, histEntry.first);
+            Discard(histEntry.second);
+        }
+        runs_.erase(it);
+    }
+
+    // Frees every cached histogram; runs are read again on their next request
+    void Clear() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& runEntry : runs_) {
+                for (auto& histEntry : runEntry.second.hists) {
+                    Discard(histEntry.second);
+                }
+            }
+            runs_.clear();
+            lru_.clear();
+            lruIndex_.clear();
+            residentBytes_ = 0;
+        }
+        {
+            std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+            CloseSourceFile();
+        }
+        // Taken after mutex_ is released: LoadConsolidated() takes the two locks in the opposite order
+        std::lock_guard<std::mutex> consolidatedLock(consolidatedMutex_);
+        consolidatedLoaded_ = false;
+    }
+
+private:
+    RunHistCache() = default;
+
+    // Directory where the per-run ROOT files are located
+    std::string baseDir_ = "/Users/patsfan753/Desktop/QA_EMCal/rootOutput/";
+
+    // Histograms read from every run as soon as the run is first requested
+    std::vector<std::string> histNames_ = {"hClusterChi", "hClusterPt", "hClusterECore", "hTotalCaloE", "hTotalMBD"};
+
+    // Cached entries keyed by run number (element references stay valid while other runs are added)
+    std::unordered_map<std::string, RunEntry> runs_;
+    
+    // Guards runs_, histNames_ and the LRU bookkeeping
+    mutable std::mutex mutex_;
+
+    // Struct to hold one cached histogram in the LRU list
+    struct LruSlot {
+        std::string run;
+        std::string histName;
+        long long bytes;
+    };
+    std::list<LruSlot> lru_;            // Cached histograms, most recently used first
+    std::unordered_map<std::string, std::list<LruSlot>::iterator> lruIndex_;   // "<run>/<hist>" -> slot in lru_
+    long long residentBytes_ = 0;       // Sum of the bytes of every slot
+    long long budgetBytes_ = 0;         // Memory budget, 0 = unlimited
+    CacheStats stats_;                  // Hit, miss, eviction and peak counters
+    std::unordered_map<const TH1F*, int> pins_;     // Histograms being read by WithHist -> number of readers
+    std::unordered_set<TH1F*> discarded_;           // Pinned histograms that already left the cache
+
+    // Consolidated file kept open for re-reading evicted histograms (see ReadSource)
+    TFile* sourceFile_ = nullptr;
+    std::string sourcePath_;
+    std::mutex sourceMutex_;            // Guards sourceFile_; reads through one TFile are not concurrent
+
+    // Remote access settings (see SetOpenTimeout, SetOpenRetries and SetVectoredReads)
+    int openTimeout_ = 0;
+    int openRetries_ = 0;
+    int retryDelayMs_ = 1000;
+    bool vectoredReads_ = true;
+    bool lazyLoading_ = false;          // Consolidated runs hold no histograms until asked for (see SetLazyLoading)
+
+    // Consolidated cache file (see GetConsolidatedPath) and whether it has been read since the last Clear()
+    std::string consolidatedFile_;
+    bool consolidatedLoaded_ = false;
+    bool staleCheck_ = false;           // Whether LoadConsolidated() skips runs with a newer qa.root
+    std::mutex consolidatedMutex_;      // Held while the consolidated file is read, so it is only read once
+
+    // Read every run of the consolidated cache file into runs_ with one open of one file
+    void LoadConsolidated() {
+        std::lock_guard<std::mutex> consolidatedLock(consolidatedMutex_);
+        if (consolidatedLoaded_) {
+            return;
+        }
+        consolidatedLoaded_ = true;
+        const std::string path = GetConsolidatedPath();
+        // AccessPathName returns true if the file does NOT exist
+        if (consolidatedFile_ == "none" || gSystem->AccessPathName(path.c_str())) {
+            return;
+        }
+        std::vector<std::string> names;
+        bool metadataOnly = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            names = histNames_;
+            metadataOnly = budgetBytes_ > 0 || lazyLoading_;
+        }
+
+        FileStat_t consolidatedStat;
+        const bool hasStat = staleCheck_ && gSystem->GetPathInfo(path.c_str(), consolidatedStat) == 0;
+
+        StageTimer timer;
+        TFile *file = TFile::Open(path.c_str());
+        const double openMs = timer.Lap();
+        if (!file || file->IsZombie()) {
+            delete file;
+            return;
+        }
+
+        std::vector<std::pair<std::string, RunEntry>> loaded;
+        int nStale = 0;
+        TIter nextKey(file->GetListOfKeys());
+        while (TKey *key = (TKey*)nextKey()) {
+            TDirectory *dir = file->GetDirectory(key->GetName());
+            if (!dir) {
+                continue;
+            }
+            // A run reprocessed after the consolidation is read from its own, newer qa.root instead
+            FileStat_t runStat;
+            if (hasStat && gSystem->GetPathInfo(GetFilePath(key->GetName()).c_str(), runStat) == 0
+                && runStat.fMtime > consolidatedStat.fMtime) {
+                nStale++;
+                continue;
+            }
+            RunEntry entry;
+            entry.fileOk = true;
+            TParameter<double> *nEvents = (TParameter<double>*)dir->Get("nEvents");
+            if (nEvents) {
+                entry.nEvents = nEvents->GetVal();
+            }
+            TNamed *keys = (TNamed*)dir->Get("keys");
+            if (keys) {
+                std::stringstream ss(keys->GetTitle());
+                std::string name;
+                while (std::getline(ss, name, ',')) {
+                    entry.keys.insert(name);
+                }
+            }
+            entry.source = path;
+            entry.sourceDir = key->GetName();
+            if (metadataOnly) {
+                // Under a memory budget or with lazy loading the histograms are read when first asked for
+                for (const auto& name : names) {
+                    if (dir->GetKey(name.c_str())) {
+                        entry.unloaded.insert(name);
+                    }
+                }
+            } else {
+                ReadHists(dir, entry, names);
+            }
+            loaded.emplace_back(key->GetName(), std::move(entry));
+        }
+
+        // The whole read is booked on the first run, so the timing report shows it once
+        if (!loaded.empty()) {
+            loaded.front().second.openMs = openMs;
+            loaded.front().second.getMs = timer.Lap();
+            loaded.front().second.bytesRead = file->GetBytesRead();
+        }
+        file->Close();
+        delete file;
+        if (nStale > 0) {
+            std::cout << nStale << " runs are newer than " << path << " and are read from their qa.root; re-run the consolidation" << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& runEntry : loaded) {
+            auto inserted = runs_.try_emplace(runEntry.first, std::move(runEntry.second));
+            if (!inserted.second) {
+                for (auto& histEntry : runEntry.second.hists) {
+                    delete histEntry.second;
+                }
+                continue;
+            }
+            for (const auto& histEntry : inserted.first->second.hists) {
+                Track(runEntry.first, histEntry.first, histEntry.second);
+            }
+        }
+        EvictOverBudget();
+    }
+
+    // Open the run's file once and read the event count plus every known histogram
+    RunEntry LoadRun(const std::string& run) {
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            names = histNames_;
+        }
+        return LoadRun(run, names);
+    }
+
+    RunEntry LoadRun(const std::string& run, const std::vector<std::string>& names) {
+        RunEntry entry;
+        entry.source = GetFilePath(run);
+
+        StageTimer timer;
+        TFile *file = OpenFile(entry.source, entry);
+        entry.openMs = timer.Lap();
+        if (!file) {
+            return entry;
+        }
+        entry.fileOk = true;
+
+        // The key list is already in memory after the open; remember it so optional content (e.g. trees) can be checked later
+        TIter nextKey(file->GetListOfKeys());
+        while (TKey *key = (TKey*)nextKey()) {
+            entry.keys.insert(key->GetName());
+        }
+
+        // Number of events from number of clusters histogram (filled once per event), read in the same batch
+        std::vector<std::string> toRead(names);
+        toRead.push_back("hNClusters");
+        ReadFileHists(file, entry, toRead);
+        auto nClusters = entry.hists.find("hNClusters");
+        if (nClusters != entry.hists.end()) {
+            entry.nEvents = nClusters->second->GetEntries();
+            delete nClusters->second;
+            entry.hists.erase(nClusters);
+        }
+        entry.getMs = timer.Lap();
+        entry.bytesRead = file->GetBytesRead();
+
+        file->Close();
+        delete file;
+        return entry;
+    }
+
+    // Re-open the file a run came from to read histograms requested later in the session (or evicted)
+    // Called without the cache lock; the caller adds the returned histograms to the run with AddHists()
+    std::unordered_map<std::string, TH1F*> ReadSource(const std::string& source, const std::string& sourceDir,
+                                                      const std::vector<std::string>& names) {
+        RunEntry reopened;
+        if (!sourceDir.empty()) {
+            // A run of the consolidated file: read its directory through the handle kept open for the session
+            std::lock_guard<std::mutex> sourceLock(sourceMutex_);
+            if (!sourceFile_ || sourcePath_ != source) {
+                CloseSourceFile();
+                sourceFile_ = OpenFile(source, reopened);
+                sourcePath_ = source;
+            }
+            if (sourceFile_) {
+                if (TDirectory *dir = sourceFile_->GetDirectory(sourceDir.c_str())) {
+                    ReadHists(dir, reopened, names);
+                }
+            }
+            return reopened.hists;
+        }
+        TFile *file = OpenFile(source, reopened);
+        if (!file) {
+            return reopened.hists;
+        }
+        ReadFileHists(file, reopened, names);
+        file->Close();
+        delete file;
+        return reopened.hists;
+    }
+
+    // Put freshly read histograms into a cached run (keeping any copy another thread added first)
+    void AddHists(const std::string& run, RunEntry& entry, std::unordered_map<std::string, TH1F*>& read) {
+        for (auto& histEntry : read) {
+            entry.unloaded.erase(histEntry.first);
+            if (!entry.hists.emplace(histEntry.first, histEntry.second).second) {
+                delete histEntry.second;
+                continue;
+            }
+            Track(run, histEntry.first, histEntry.second);
+        }
+    }
+
+    // Approximate memory of a histogram: the object plus its bin contents and errors
+    static long long HistBytes(const TH1F* hist) {
+        return (long long)sizeof(TH1F) + (long long)hist->GetNcells() * sizeof(Float_t) + (long long)hist->GetSumw2N() * sizeof(Double_t);
+    }
+
+    // LRU bookkeeping, always called with mutex_ held
+    static std::string LruKey(const std::string& run, const std::string& histName) { return run + "/" + histName; }
+
+    void Track(const std::string& run, const std::string& histName, const TH1F* hist) {
+        const long long bytes = HistBytes(hist);
+        lru_.push_front({run, histName, bytes});
+        lruIndex_[LruKey(run, histName)] = lru_.begin();
+        residentBytes_ += bytes;
+        stats_.peakBytes = std::max(stats_.peakBytes, residentBytes_);
+    }
+
+    void Untrack(const std::string& run, const std::string& histName) {
+        auto it = lruIndex_.find(LruKey(run, histName));
+        if (it != lruIndex_.end()) {
+            residentBytes_ -= it->second->bytes;
+            lru_.erase(it->second);
+            lruIndex_.erase(it);
+        }
+    }
+
+    void Touch(const std::string& run, const std::string& histName) {
+        auto it = lruIndex_.find(LruKey(run, histName));
+        if (it != lruIndex_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+        }
+    }
+
+    // Free the least recently used histograms until the resident bytes fit the budget
+    // The most recently used histogram always stays, so a budget below one histogram still works;
+    // pinned histograms are passed over (they are being read) and evicted by a later call
+    void EvictOverBudget() {
+        if (budgetBytes_ <= 0 || lru_.empty()) {
+            return;
+        }
+        auto slot = std::prev(lru_.end());
+        while (residentBytes_ > budgetBytes_ && slot != lru_.begin()) {
+            auto older = std::prev(slot);
+            auto run = runs_.find(slot->run);
+            TH1F* hist = nullptr;
+            if (run != runs_.end()) {
+                auto hit = run->second.hists.find(slot->histName);
+                if (hit != run->second.hists.end()) {
+                    hist = hit->second;
+                }
+            }
+            if (hist && pins_.count(hist)) {
+                slot = older;
+                continue;
+            }
+            if (hist) {
+                delete hist;
+                run->second.hists.erase(slot->histName);
+                run->second.unloaded.insert(slot->histName);
+            }
+            residentBytes_ -= slot->bytes;
+            lruIndex_.erase(LruKey(slot->run, slot->histName));
+            lru_.erase(slot);
+            stats_.evictions++;
+            slot = older;
+        }
+    }
+
+    // Free a histogram that leaves the cache, or leave it to the last reader still holding a pin on it
+    void Discard(TH1F* hist) {
+        if (pins_.count(hist)) {
+            discarded_.insert(hist);
+        } else {
+            delete hist;
+        }
+    }
+
+    // Drop one pin taken by WithHist, freeing the histogram if it left the cache while it was pinned
+    void Unpin(TH1F* hist) {
+        auto pin = pins_.find(hist);
+        if (pin == pins_.end() || --pin->second > 0) {
+            return;
+        }
+        pins_.erase(pin);
+        if (discarded_.erase(hist)) {
+            delete hist;
+        }
+    }
+
+    // Close the kept consolidated file handle; called with sourceMutex_ held
+    void CloseSourceFile() {
+        if (sourceFile_) {
+            sourceFile_->Close();
+            delete sourceFile_;
+            sourceFile_ = nullptr;
+        }
+        sourcePath_.clear();
+    }
+
+    // Open a file with the configured timeout and retries; nullptr (with the reason in entry.error) if it cannot be read
+    TFile* OpenFile(const std::string& path, RunEntry& entry) {
+        const std::string option = openTimeout_ > 0 ? "TIMEOUT=" + std::to_string(openTimeout_) : "";
+        for (int attempt = 0; attempt <= openRetries_; attempt++) {
+            if (attempt > 0) {
+                gSystem->Sleep(retryDelayMs_ * attempt);
+            }
+            entry.attempts = attempt + 1;
+            TFile *file = TFile::Open(path.c_str(), option.c_str());
+            if (file && !file->IsZombie()) {
+                entry.error.clear();
+                return file;
+            }
+            delete file;
+            entry.error = "cannot open " + path + " after " + std::to_string(entry.attempts) + " attempt(s)";
+        }
+        return nullptr;
+    }
+
+    // Read histograms from the top directory of an open file, in one vectored read when enabled
+    // The key headers are already in memory after the open, so their positions and sizes are known up front
+    void ReadFileHists(TFile* file, RunEntry& entry, const std::vector<std::string>& names) {
+        if (!vectoredReads_) {
+            ReadHists(file, entry, names);
+            return;
+        }
+
+        std::vector<TKey*> keys;
+        std::vector<std::string> keyNames;
+        std::vector<Long64_t> positions;
+        std::vector<Int_t> lengths;
+        size_t total = 0;
+        for (const auto& name : names) {
+            TKey *key = file->GetKey(name.c_str());
+            if (key) {
+                keys.push_back(key);
+                keyNames.push_back(name);
+                positions.push_back(key->GetSeekKey());
+                lengths.push_back(key->GetNbytes());
+                total += key->GetNbytes();
+            }
+        }
+        if (keys.empty()) {
+            return;
+        }
+
+        // ReadBuffers returns true on failure; fall back to reading the keys one by one
+        std::vector<char> buffer(total);
+        if (file->ReadBuffers(buffer.data(), positions.data(), lengths.data(), (Int_t)keys.size())) {
+            ReadHists(file, entry, names);
+            return;
+        }
+        size_t offset = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            TH1F *hist = (TH1F*)keys[i]->ReadObjWithBuffer(buffer.data() + offset);
+            offset += lengths[i];
+            if (hist) {
+                hist->SetDirectory(nullptr);
+                entry.hists[keyNames[i]] = hist;
+            }
+        }
+    }
+
+    // Detach the requested histograms from the file so they survive its Close()
+    void ReadHists(TDirectory* dir, RunEntry& entry, const std::vector<std::string>& names) {
+        for (const auto& name : names) {
+            TH1F *hist = (TH1F*)dir->Get(name.c_str());
+            if (hist) {
+                hist->SetDirectory(nullptr);
+                entry.hists[name] = hist;
+            }
+        }
+    }
+};
+
+#endif // QA_RUN_CACHE_H
@@ -0,0 +1,352 @@
+// Run catalog shared by the EMCal QA plotting macros
+
+/*
+   CATALOG OVERVIEW:
+   RunCatalog holds the list of runs to process together with their SEB (Sub-Event Buffer) counts,
+   overlay colors and good-run flags. It replaces the run maps that used to be hard-coded in each plotter.
+   Runs can be streamed from a CSV file or from a run-database query and filtered by run range or
+   good-run flag before being handed to SinglePlotter or OverlayPlotter.
+   Group() partitions the runs into groups of bounded size (by SEB count or run-number range), so a long
+   run list can be overlaid as several readable canvases instead of one.
+   Every run also carries its run number as an integer id, which is what lookups, sorting and range
+   selections use: the catalog is indexed by a sorted flat array of ids, not by hashed strings.
+   Every loaded catalog (and every catalog handed to a plotter) is in ascending run order, so all passes
+   walk the contiguous run array linearly in run order, whatever order the CSV or database listed them in.
+   The run number is also kept as a string: it is the directory and ROOT key name of the run, so files and
+   cache entries are addressed with it as written. The normalization is not stored in RunInfo because it
+   needs the run's event count, which the shared cache reads lazily on any thread; NormalizationTable keeps
+   it in its own id-sorted array behind a lock, while catalogs stay plain values copied into each plotter.
+   Shard() deals the runs out to N batch jobs: taken in run-number order, every N-th run goes to the same
+   shard, so each job gets a deterministic, balanced subset whatever order the CSV lists the runs in.
+
+   CSV format (one run per line, '#' starts a comment, a non-numeric first line is taken as a header):
+       run,sebCount[,good[,color]]
+*/
+
+#ifndef QA_RUN_CATALOG_H
+#define QA_RUN_CATALOG_H
+
+#include <TColor.h>
+#include <TStyle.h>
+#include <algorithm>
+#include <TSQLServer.h>
+#include <TSQLResult.h>
+#include <TSQLRow.h>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Struct to hold the catalog information for one run
+struct RunInfo {
+    std::string run;    // Run number, also the run's directory name under the input base directory
+    int sebCount;       // Count of Sub Event Buffers (SEBs) for the run
+    Color_t color;      // Color for this run's histogram in overlays
+    bool good;          // Good-run flag
+    int id = 0;         // Run number as an integer (set by RunCatalog::Add)
+};
+
+// How the runs are split into groups for overlays
+enum class RunGrouping { kNone = 0, kSebCount = 1, kRunRange = 2 };
+
+// Struct to hold one group of runs drawn together
+struct RunGroup {
+    std::string label;          // Suffix naming the group in output files and titles, empty for a single group
+    std::vector<RunInfo> runs;  // Runs of the group, colored for the group
+};
+
+class RunCatalog {
+public:
+
+    // The default set of runs; run numbers, SEB counts and colors of the original QA campaign
+    static RunCatalog Default() {
+        RunCatalog catalog;
+        // (Run Number, SEB Count, Color)
+        catalog.Add({"21813", 7, kBlue, true});
+        catalog.Add({"21796", 8, kOrange+7, true});
+        catalog.Add({"21615", 8, kBlack, true});
+        catalog.Add({"21599", 8, kBlue+3, true});
+        catalog.Add({"21598", 8, kRed, true});
+        catalog.Add({"21891", 7, kCyan+3, true});
+        catalog.Add({"22979", 5, kMagenta, true});
+        catalog.Add({"22950", 5, kViolet+1, true});
+        catalog.Add({"22949", 5, kMagenta+2, true});
+        catalog.Add({"22951", 5, kAzure+4, true});
+        catalog.Add({"22982", 5, kAzure+2, true});
+        catalog.Add({"21518", 8, kPink-3, true});
+        catalog.Add({"21520", 8, kOrange+1, true});
+        catalog.Add({"21889", 7, kGray+1, true});
+        catalog.SortByRun();
+        return catalog;
+    }
+
+    // Stream runs from a CSV file, one line at a time
+    static RunCatalog FromCSV(const std::string& path) {
+        RunCatalog catalog;
+        std::ifstream in(path);
+        if (!in) {
+            std::cout << "Run catalog issue: cannot open " << path << std::endl;
+            return catalog;
+        }
+
+        std::string line;
+        int lineNumber = 0;
+        bool firstLine = true;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            // Strip comments and skip blank lines
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") == std::string::npos) {
+                continue;
+            }
+
+            std::vector<std::string> fields;
+            std::stringstream ss(line);
+            std::string field;
+            while (std::getline(ss, field, ',')) {
+                fields.push_back(Trim(field));
+            }
+
+            // Only the first line may be a header, recognized by its non-numeric run column
+            const bool headerCandidate = firstLine;
+            firstLine = false;
+            if (headerCandidate && !IsNumber(fields[0])) {
+                continue;
+            }
+            if (fields.size() < 2 || !IsNumber(fields[0]) || !IsNumber(fields[1])) {
+                std::cout << "Run catalog issue: skipping malformed line " << lineNumber << " of " << path << std::endl;
+                continue;
+            }
+
+            RunInfo info;
+            info.run = fields[0];
+            info.sebCount = std::atoi(fields[1].c_str());
+            info.good = fields.size() < 3 || fields[2].empty() || ParseFlag(fields[2]);
+            info.color = (fields.size() >= 4 && IsNumber(fields[3])) ? (Color_t)std::atoi(fields[3].c_str()) : catalog.NextColor();
+            catalog.Add(info);
+        }
+        std::cout << "Loaded " << catalog.Size() << " runs from " << path << std::endl;
+        catalog.SortByRun();
+        return catalog;
+    }
+
+    // Stream runs from a run database through ROOT's SQL interface
+    // The query must return the columns: run, sebCount and (optionally) a good-run flag
+    static RunCatalog FromDatabase(const std::string& url, const std::string& user, const std::string& password, const std::string& query) {
+        RunCatalog catalog;
+        TSQLServer *db = TSQLServer::Connect(url.c_str(), user.c_str(), password.c_str());
+        if (!db || !db->IsConnected()) {
+            std::cout << "Run catalog issue: cannot connect to " << url << std::endl;
+            delete db;
+            return catalog;
+        }
+
+        TSQLResult *result = db->Query(query.c_str());
+        if (!result || result->GetFieldCount() < 2) {
+            std::cout << "Run catalog issue: query returned no usable columns: " << query << std::endl;
+            delete result;
+            delete db;
+            return catalog;
+        }
+
+        const bool hasGoodFlag = result->GetFieldCount() >= 3;
+        while (TSQLRow *row = result->Next()) {
+            const char *run = row->GetField(0);
+            const char *sebCount = row->GetField(1);
+            if (run && sebCount) {
+                RunInfo info;
+                info.run = run;
+                info.sebCount = std::atoi(sebCount);
+                info.good = !hasGoodFlag || !row->GetField(2) || ParseFlag(row->GetField(2));
+                info.color = catalog.NextColor();
+                catalog.Add(info);
+            }
+            delete row;
+        }
+        delete result;
+        delete db;
+        std::cout << "Loaded " << catalog.Size() << " runs from " << url << std::endl;
+        catalog.SortByRun();
+        return catalog;
+    }
+
+    // Runs of a plotter config: from the run database if dbUrl is set, else from the CSV runList, else the default runs
+    static RunCatalog Load(const std::string& runList, const std::string& dbUrl = "", const std::string& dbUser = "",
+                           const std::string& dbPassword = "", const std::string& dbQuery = "") {
+        if (!dbUrl.empty()) {
+            return FromDatabase(dbUrl, dbUser, dbPassword, dbQuery);
+        }
+        return runList.empty() ? Default() : FromCSV(runList);
+    }
+
+    // Returns the runs within [minRun, maxRun] (0 = no limit), optionally only the good ones
+    RunCatalog Filter(int minRun, int maxRun, bool goodOnly) const {
+        RunCatalog filtered;
+        for (const auto& info : runs_) {
+            if ((minRun > 0 && info.id < minRun) || (maxRun > 0 && info.id > maxRun) || (goodOnly && !info.good)) {
+                continue;
+            }
+            filtered.Add(info);
+        }
+        return filtered;
+    }
+
+    // The index-th of count disjoint subsets (0 <= index < count) covering the whole catalog
+    RunCatalog Shard(int index, int count) const {
+        RunCatalog shard;
+        for (size_t i = 0; i < index_.size(); i++) {
+            if (count <= 1 || (int)(i % count) == index) {
+                shard.Add(runs_[index_[i].second]);
+            }
+        }
+        return shard;
+    }
+
+    // Returns the runs of this catalog that are listed in runs, in catalog order
+    RunCatalog Select(const std::vector<std::string>& runs) const {
+        std::vector<int> ids;
+        for (const auto& run : runs) {
+            ids.push_back(std::atoi(run.c_str()));
+        }
+        std::sort(ids.begin(), ids.end());
+        RunCatalog selected;
+        for (const auto& info : runs_) {
+            if (std::binary_search(ids.begin(), ids.end(), info.id)) {
+                selected.Add(info);
+            }
+        }
+        return selected;
+    }
+
+    // Add a run; a run that is already in the catalog is updated in place
+    // Appending runs in ascending order (the usual order of run lists) keeps every insertion into the index O(1)
+    void Add(const RunInfo& info) {
+        RunInfo added(info);
+        added.id = std::atoi(info.run.c_str());
+        auto it = LowerBound(added.id);
+        if (it != index_.end() && it->first == added.id) {
+            runs_[it->second] = added;
+            return;
+        }
+        index_.insert(it, {added.id, runs_.size()});
+        runs_.push_back(added);
+    }
+
+    // Look up a run by number, nullptr if it is not in the catalog
+    const RunInfo* Find(int id) const {
+        auto it = LowerBound(id);
+        return (it != index_.end() && it->first == id) ? &runs_[it->second] : nullptr;
+    }
+    const RunInfo* Find(const std::string& run) const { return Find(std::atoi(run.c_str())); }
+
+    // Put the runs in ascending run-number order, the order every plotter then walks them in
+    void SortByRun() {
+        std::stable_sort(runs_.begin(), runs_.end(), [](const RunInfo& a, const RunInfo& b) { return a.id < b.id; });
+        for (size_t i = 0; i < runs_.size(); i++) {
+            index_[i] = {runs_[i].id, i};
+        }
+    }
+
+    // Partition the runs into groups of at most maxSize runs (0 = unbounded)
+    // kSebCount groups runs with the same SEB count, kRunRange groups consecutive run numbers, kNone keeps catalog order
+    // Unless everything fits in one group, the runs of each group are recolored across the current palette so
+    // neighbouring runs of a group stay distinguishable however long the catalog is
+    std::vector<RunGroup> Group(RunGrouping by, size_t maxSize) const {
+        std::vector<RunInfo> sorted(runs_);
+        if (by == RunGrouping::kSebCount) {
+            std::stable_sort(sorted.begin(), sorted.end(), [](const RunInfo& a, const RunInfo& b) { return a.sebCount < b.sebCount; });
+        } else if (by == RunGrouping::kRunRange) {
+            std::stable_sort(sorted.begin(), sorted.end(), [](const RunInfo& a, const RunInfo& b) { return a.id < b.id; });
+        }
+
+        std::vector<RunGroup> groups;
+        for (const auto& info : sorted) {
+            bool newGroup = groups.empty() || (maxSize > 0 && groups.back().runs.size() >= maxSize) ||
+                            (by == RunGrouping::kSebCount && groups.back().runs.back().sebCount != info.sebCount);
+            if (newGroup) {
+                groups.emplace_back();
+            }
+            groups.back().runs.push_back(info);
+        }
+        if (groups.size() <= 1) {
+            return groups;
+        }
+
+        int part = 0;
+        for (size_t g = 0; g < groups.size(); g++) {
+            RunGroup& group = groups[g];
+            const RunInfo& first = group.runs.front();
+            if (by == RunGrouping::kSebCount) {
+                // Count the parts of one SEB count separately: SEB8_1, SEB8_2, ...
+                part = (g > 0 && groups[g - 1].runs.front().sebCount == first.sebCount) ? part + 1 : 1;
+                group.label = "SEB" + std::to_string(first.sebCount) + "_" + std::to_string(part);
+            } else if (by == RunGrouping::kRunRange) {
+                group.label = "Runs" + first.run + "-" + group.runs.back().run;
+            } else {
+                group.label = "Part" + std::to_string(g + 1);
+            }
+            ApplyPalette(group.runs);
+        }
+        return groups;
+    }
+
+    size_t Size() const { return runs_.size(); }
+    const std::vector<RunInfo>& Runs() const { return runs_; }
+    std::vector<RunInfo>::const_iterator begin() const { return runs_.begin(); }
+    std::vector<RunInfo>::const_iterator end() const { return runs_.end(); }
+
+private:
+    std::vector<RunInfo> runs_;                          // Runs in catalog order
+    std::vector<std::pair<int, size_t>> index_;          // (run id, position in runs_), sorted by id
+
+    // First index entry whose id is not below id
+    std::vector<std::pair<int, size_t>>::const_iterator LowerBound(int id) const {
+        if (!index_.empty() && index_.back().first < id) {
+            return index_.end();
+        }
+        return std::lower_bound(index_.begin(), index_.end(), id,
+                                [](const std::pair<int, size_t>& entry, int value) { return entry.first < value; });
+    }
+
+    // Colors handed out to runs that do not specify one, cycling through the default palette
+    Color_t NextColor() const {
+        static const Color_t colors[] = {kBlue, kOrange+7, kBlack, kBlue+3, kRed, kCyan+3, kMagenta,
+                                         kViolet+1, kMagenta+2, kAzure+4, kAzure+2, kPink-3, kOrange+1, kGray+1};
+        return colors[runs_.size() % (sizeof(colors) / sizeof(colors[0]))];
+    }
+
+    // Spread the colors of runs over the current palette (gStyle->SetPalette), first to last
+    static void ApplyPalette(std::vector<RunInfo>& runs) {
+        const int nColors = TColor::GetNumberOfColors();
+        if (nColors <= 0) {
+            return;
+        }
+        for (size_t i = 0; i < runs.size(); i++) {
+            size_t index = runs.size() > 1 ? i * (nColors - 1) / (runs.size() - 1) : 0;
+            runs[i].color = (Color_t)TColor::GetColorPalette((Int_t)index);
+        }
+    }
+
+    static std::string Trim(const std::string& s) {
+        size_t first = s.find_first_not_of(" \t\r\"");
+        if (first == std::string::npos) {
+            return "";
+        }
+        size_t last = s.find_last_not_of(" \t\r\"");
+        return s.substr(first, last - first + 1);
+    }
+
+    static bool IsNumber(const std::string& s) {
+        return !s.empty() && s.find_first_not_of("0123456789") == std::string::npos;
+    }
+
+    // Accepts 1/0, true/false, yes/no, good/bad
+    static bool ParseFlag(const std::string& s) {
+        return s == "1" || s == "true" || s == "yes" || s == "good" || s == "TRUE" || s == "Yes";
+    }
+};
+
+#endif // QA_RUN_CATALOG_H
@@ -0,0 +1,77 @@
+// Run fetching shared by the EMCal QA plotters
+
+/*
+   RUN FETCH OVERVIEW:
+   Both plotters take their runs from the shared RunHistCache in the same way: fetch a run (reading its
+   qa.root if no plotter has asked for it yet), optionally start reading the next run in the background,
+   and record every actual file read once in their timing report. These helpers hold that logic, together
+   with the input settings both plotters' configs apply to the cache.
+*/
+
+#ifndef QA_RUN_FETCH_H
+#define QA_RUN_FETCH_H
+
+#include <future>
+#include <string>
+#include "QARunCache.h"
+#include "QATiming.h"
+
+// Add the timing record of one run's file read to report (nullptr = timing disabled)
+inline void RecordFileRead(TimingReport* report, const std::string& run, const RunHistCache::RunEntry& entry) {
+    if (report) {
+        StageRecord record;
+        record.run = run;
+        record.histName = "*";
+        record.ms[kStageOpen] = entry.openMs;
+        record.ms[kStageGet] = entry.getMs;
+        record.bytesRead = entry.bytesRead;
+        report->Add(record);
+    }
+}
+
+// Fetch a run from the shared cache; the file read is recorded once per run, by whichever call actually opened it
+inline const RunHistCache::RunEntry& FetchCachedRun(const std::string& run, TimingReport* report) {
+    bool loadedNow = false;
+    const RunHistCache::RunEntry& entry = RunHistCache::Instance().GetRun(run, &loadedNow);
+    if (loadedNow) {
+        RecordFileRead(report, run, entry);
+    }
+    return entry;
+}
+
+// Start reading a run into the shared cache on a background thread
+// The future holds whether that read opened the run's file (false if the run was already cached)
+inline std::future<bool> PrefetchRun(const std::string& run) {
+    return std::async(std::launch::async, [run]() {
+        bool loadedNow = false;
+        RunHistCache::Instance().GetRun(run, &loadedNow);
+        return loadedNow;
+    });
+}
+
+// Wait for a pending prefetch of run (if any) and record its file read
+inline void FinishPrefetch(std::future<bool>& prefetch, const std::string& run, TimingReport* report) {
+    if (prefetch.valid() && prefetch.get()) {
+        RecordFileRead(report, run, RunHistCache::Instance().GetRun(run));
+    }
+}
+
+// Apply the input settings of a plotter config to the shared cache (empty strings keep the current setting)
+// memoryBudgetMB > 0 caps the cached histograms at that many MB, evicting the least recently used ones
+// checkStale reads runs reprocessed since the consolidation from their qa.root (one stat per run, see SetStaleCheck)
+inline void ConfigureRunCache(const std::string& inputDir, const std::string& cacheFile, int openTimeout, int openRetries,
+                              double memoryBudgetMB = 0, bool checkStale = false) {
+    RunHistCache& cache = RunHistCache::Instance();
+    if (!inputDir.empty()) {
+        cache.SetBaseDir(inputDir);
+    }
+    if (!cacheFile.empty()) {
+        cache.SetConsolidatedFile(cacheFile);
+    }
+    cache.SetOpenTimeout(openTimeout);
+    cache.SetOpenRetries(openRetries);
+    cache.SetMemoryBudget(memoryBudgetMB > 0 ? (long long)(memoryBudgetMB * 1024 * 1024) : 0);
+    cache.SetStaleCheck(checkStale);
+}
+
+#endif // QA_RUN_FETCH_H
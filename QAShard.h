@@ -0,0 +1,147 @@
+// Sharded batch execution of the EMCal QA plotting macros
+
+/*
+   SHARD OVERVIEW:
+   A full campaign can be spread over a batch pool by giving every job a shard "i/N" (0 <= i < N, e.g.
+   HTCondor's $(Process)/$(N)). RunCatalog::Shard() hands each job a deterministic subset of the runs.
+   The job first consolidates its subset into a partial file, <partialDir>/qa_shard_<i>of<N>.root, and
+   then plots from that file, so each qa.root is read once and the single-run images are written directly.
+   The partial file keeps the raw histograms with each run's event and SEB counts (the consolidated
+   layout of RunHistCache) rather than scaled copies, so the merge step normalizes exactly like an
+   unsharded pass would. The merge step is told N and combines exactly the files qa_shard_0ofN ...
+   qa_shard_<N-1>ofN of partialDir into <partialDir>/qa_shard_merged.root, then builds the overlays and
+   summary tables from it alone; no qa.root is opened again. Partial files of an earlier split with another
+   N are ignored, and the merge fails if any of the N shards is missing, instead of overlaying a partial
+   campaign. Both steps default to the same partialDir, <inputDir>/qa_shards/, so it only has to be given
+   when the input directory is not writable or not shared by the jobs.
+
+   Usage (one job per shard, then one merge job):
+       root -l -b -q -e '.L SinglePlotGenerator.cpp' -e 'SinglePlotGeneratorShard("3/20", "runs.csv", "/shared/partials/")'
+       root -l -b -q -e '.L OverlayedPlotGenerator.cpp' -e 'OverlayedPlotGeneratorMerge(20, "/shared/partials/", "runs.csv")'
+*/
+
+#ifndef QA_SHARD_H
+#define QA_SHARD_H
+
+#include <TSystem.h>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "QARunCache.h"
+#include "QARunCatalog.h"
+
+// Struct to hold which part of the run catalog a batch job processes
+struct ShardSpec {
+    int index = 0;      // Shard processed by this job, 0-based
+    int count = 1;      // Total number of shards, 1 = not sharded
+
+    bool IsSharded() const { return count > 1; }
+};
+
+// Parse "i/N" into shard; returns false (leaving shard unchanged) unless 0 <= i < N
+inline bool ParseShard(const std::string& spec, ShardSpec& shard) {
+    int index = -1;
+    int count = 0;
+    char end = 0;
+    if (std::sscanf(spec.c_str(), "%d/%d%c", &index, &count, &end) != 2 || count < 1 || index < 0 || index >= count) {
+        return false;
+    }
+    shard.index = index;
+    shard.count = count;
+    return true;
+}
+
+// Directory with a trailing slash, for joining with file names
+inline std::string ShardDir(const std::string& dir) {
+    return dir.empty() || dir.back() == '/' ? dir : dir + "/";
+}
+
+// Partial file written by one shard
+inline std::string ShardPartialPath(const std::string& partialDir, const ShardSpec& shard) {
+    return ShardDir(partialDir) + "qa_shard_" + std::to_string(shard.index) + "of" + std::to_string(shard.count) + ".root";
+}
+
+// Merged file built from every partial file of partialDir
+inline std::string ShardMergedPath(const std::string& partialDir) {
+    return ShardDir(partialDir) + "qa_shard_merged.root";
+}
+
+// Partial directory used when none is given: next to the input, so shard jobs and merge agree on it
+inline std::string DefaultShardDir() {
+    return ShardDir(RunHistCache::Instance().GetBaseDir()) + "qa_shards/";
+}
+
+// The partial files of the N shards of one split, in shard order, into partials
+// Returns false (naming the missing shards) unless every one of qa_shard_0ofN ... qa_shard_<N-1>ofN exists
+inline bool FindShardPartials(const std::string& partialDir, int count, std::vector<std::string>& partials) {
+    partials.clear();
+    if (count < 1) {
+        std::cout << "Merge issue: invalid shard count " << count << std::endl;
+        return false;
+    }
+    std::vector<int> missing;
+    ShardSpec shard;
+    shard.count = count;
+    for (shard.index = 0; shard.index < count; shard.index++) {
+        const std::string path = ShardPartialPath(partialDir, shard);
+        // AccessPathName returns true when the file does NOT exist
+        if (gSystem->AccessPathName(path.c_str())) {
+            missing.push_back(shard.index);
+        } else {
+            partials.push_back(path);
+        }
+    }
+    if (!missing.empty()) {
+        std::cout << "Merge issue: " << missing.size() << " of " << count << " shard files missing in " << partialDir << " (shards";
+        for (size_t i = 0; i < missing.size() && i < 10; i++) {
+            std::cout << (i == 0 ? " " : ", ") << missing[i];
+        }
+        std::cout << (missing.size() > 10 ? ", ...)" : ")") << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Restrict catalog to the shard's runs, write their partial file and point the shared cache at it
+// Returns the number of runs in the partial file
+inline int PrepareShard(RunCatalog& catalog, const ShardSpec& shard, const std::string& partialDir) {
+    catalog = catalog.Shard(shard.index, shard.count);
+    gSystem->mkdir(partialDir.c_str(), kTRUE);
+    const std::string partial = ShardPartialPath(partialDir, shard);
+    RunHistCache& cache = RunHistCache::Instance();
+    const int nWritten = cache.Consolidate(catalog, partial);
+    // Runs that could not be consolidated are still read (and reported) from their own qa.root
+    // The partial file was just written from those files, so they are not checked for newer versions
+    cache.SetConsolidatedFile(partial);
+    cache.SetStaleCheck(false);
+    cache.Clear();
+    return nWritten;
+}
+
+// Merge the partial files of the count shards in partialDir and point the shared cache at the result
+// catalog is restricted to the runs found in the partial files, so no qa.root is opened afterwards
+// Returns the number of runs merged, 0 (merging nothing) if any shard's file is missing
+inline int MergeShards(RunCatalog& catalog, const std::string& partialDir, int count) {
+    std::vector<std::string> partials;
+    if (!FindShardPartials(partialDir, count, partials)) {
+        catalog = RunCatalog();
+        return 0;
+    }
+    std::vector<std::string> runs;
+    const std::string merged = ShardMergedPath(partialDir);
+    const int nMerged = RunHistCache::MergeConsolidated(partials, merged, &runs);
+    const RunCatalog selected = catalog.Select(runs);
+    if (selected.Size() < catalog.Size()) {
+        std::cout << "Merge issue: " << catalog.Size() - selected.Size() << " catalog runs are in no shard file and are left out" << std::endl;
+    }
+    catalog = selected;
+    RunHistCache& cache = RunHistCache::Instance();
+    // The merge reads nothing but the partial files, not even a stat of the original qa.root files
+    cache.SetConsolidatedFile(merged);
+    cache.SetStaleCheck(false);
+    cache.Clear();
+    return nMerged;
+}
+
+#endif // QA_SHARD_H
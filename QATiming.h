@@ -0,0 +1,143 @@
+// Per-stage timing instrumentation for the EMCal QA plotting macros
+
+/*
+   TIMING OVERVIEW:
+   Every plot is broken into the stages below. The plotters fill one StageRecord per run and histogram
+   (plus one per run for reading its file) into a TimingReport, which prints a per-stage summary table
+   at the end of a pass and can dump every record to a CSV file for finding slow runs and regressions.
+*/
+
+#ifndef QA_TIMING_H
+#define QA_TIMING_H
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Stages of producing a plot, in processing order
+enum TimingStage { kStageOpen, kStageGet, kStageNormalize, kStageCut, kStageDraw, kStageSave, kNTimingStages };
+
+inline const char* TimingStageName(int stage) {
+    static const char* names[kNTimingStages] = {"open", "get", "normalize", "cut", "draw", "save"};
+    return names[stage];
+}
+
+// Struct to hold the stage durations of one run and histogram
+struct StageRecord {
+    std::string run;                        // Run number
+    std::string histName;                   // Histogram, or "*" for the run's file read
+    double ms[kNTimingStages] = {0};        // Milliseconds spent in each stage
+    long long bytesRead = 0;                // Bytes read from the input file (TFile::GetBytesRead)
+
+    double Total() const {
+        double total = 0;
+        for (double t : ms) {
+            total += t;
+        }
+        return total;
+    }
+};
+
+// Stopwatch returning the time since its previous lap
+class StageTimer {
+public:
+    StageTimer() : last_(std::chrono::steady_clock::now()) {}
+
+    // Milliseconds since construction or the previous call
+    double Lap() {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - last_).count();
+        last_ = now;
+        return ms;
+    }
+
+private:
+    std::chrono::steady_clock::time_point last_;
+};
+
+// Thread-safe collection of stage records with a summary table and CSV output
+class TimingReport {
+public:
+    void Add(const StageRecord& record) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_.push_back(record);
+    }
+
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records_.clear();
+    }
+
+    // Table of total, mean and slowest duration per stage, plus the total bytes read
+    void Print(std::ostream& out = std::cout) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "================ Timing summary (" << records_.size() << " records) ================\n";
+        out << std::left << std::setw(11) << "stage" << std::right << std::setw(12) << "total [ms]" << std::setw(12) << "mean [ms]"
+            << std::setw(12) << "max [ms]" << "  slowest\n";
+
+        double grandTotal = 0;
+        long long bytes = 0;
+        for (int stage = 0; stage < kNTimingStages; stage++) {
+            double total = 0;
+            int n = 0;
+            const StageRecord* slowest = nullptr;
+            for (const auto& r : records_) {
+                if (r.ms[stage] <= 0) {
+                    continue;
+                }
+                total += r.ms[stage];
+                n++;
+                if (!slowest || r.ms[stage] > slowest->ms[stage]) {
+                    slowest = &r;
+                }
+            }
+            grandTotal += total;
+            out << std::left << std::setw(11) << TimingStageName(stage) << std::right << std::fixed << std::setprecision(1)
+                << std::setw(12) << total << std::setw(12) << (n ? total / n : 0.0) << std::setw(12) << (slowest ? slowest->ms[stage] : 0.0);
+            if (slowest) {
+                out << "  run " << slowest->run << " " << slowest->histName;
+            }
+            out << "\n";
+        }
+        for (const auto& r : records_) {
+            bytes += r.bytesRead;
+        }
+        out << std::left << std::setw(11) << "all" << std::right << std::setw(12) << grandTotal << "\n";
+        out << "bytes read: " << bytes << "\n";
+        out.unsetf(std::ios::fixed);
+        out << std::setprecision(6) << std::flush;
+    }
+
+    // One line per record: run,hist,<stage ms...>,total_ms,bytes_read
+    void WriteCSV(const std::string& path) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "Timing issue: cannot write " << path << std::endl;
+            return;
+        }
+        out << "run,hist";
+        for (int stage = 0; stage < kNTimingStages; stage++) {
+            out << "," << TimingStageName(stage) << "_ms";
+        }
+        out << ",total_ms,bytes_read\n";
+        for (const auto& r : records_) {
+            out << r.run << "," << r.histName;
+            for (double t : r.ms) {
+                out << "," << t;
+            }
+            out << "," << r.Total() << "," << r.bytesRead << "\n";
+        }
+    }
+
+private:
+    std::vector<StageRecord> records_;
+    mutable std::mutex mutex_;
+};
+
+#endif // QA_TIMING_H
@@ -0,0 +1,134 @@
+// Fill-level energy cuts from the per-cluster tree for the EMCal QA plotting macros
+
+/*
+   TREE REFILL OVERVIEW:
+   Cutting an already filled histogram can only drop whole bins, and everything below the cut is lost for good.
+   When a run's qa.root also carries the per-cluster tree, ClusterTreeRefiller instead refills the cut
+   histograms from the tree with ROOT::RDataFrame, applying the energy cut as a filter on each cluster.
+   Every (histogram, cut window) pair of a run is booked lazily on the same data frame, so all of them are
+   filled in a single event loop over the tree, which runs on ROOT's implicit multi-threading pool.
+   The refilled histograms reuse the binning of the stored ones, so they drop straight into the plotting code.
+
+   The tree is expected to hold one entry per cluster with one scalar branch per plotted quantity
+   (see SetBranch); histograms without a configured branch keep using the binned cut.
+*/
+
+#ifndef QA_TREE_REFILL_H
+#define QA_TREE_REFILL_H
+
+#include <TH1F.h>
+#include <TH1D.h>
+#include <ROOT/RDataFrame.hxx>
+#include <limits>
+#include <stdexcept>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unordered_map>
+
+class ClusterTreeRefiller {
+public:
+
+    // Struct to describe one refilled histogram: what to fill, with which binning and inside which cut window
+    struct Request {
+        std::string histName;       // Histogram to refill
+        const TH1F* binning;        // Stored histogram whose binning the refill reuses (not modified)
+        double low;                 // Lower end of the cut window
+        double high;                // Upper end of the cut window (+infinity for a pure lower cut)
+    };
+
+    // Name of the per-cluster tree inside qa.root
+    void SetTreeName(const std::string& treeName) { treeName_ = treeName; }
+    const std::string& GetTreeName() const { return treeName_; }
+
+    // Branch filled into a histogram (an empty branch disables the refill for that histogram)
+    void SetBranch(const std::string& histName, const std::string& branch) { branches_[histName] = branch; }
+    std::string GetBranch(const std::string& histName) const {
+        auto it = branches_.find(histName);
+        return it != branches_.end() ? it->second : "";
+    }
+
+    // Branch the cut window is applied to; empty (the default) cuts on the histogram's own branch,
+    // which matches what the binned cut does
+    void SetCutBranch(const std::string& cutBranch) { cutBranch_ = cutBranch; }
+    const std::string& GetCutBranch() const { return cutBranch_; }
+
+    // Whether a histogram can be refilled from the tree
+    bool Supports(const std::string& histName) const {
+        auto it = branches_.find(histName);
+        return it != branches_.end() && !it->second.empty();
+    }
+
+    // Refill every request from the tree of one file in a single event loop
+    // Returns one detached histogram per request in request order (owned by the caller), or an empty
+    // vector if the tree could not be read, with the reason in error
+    std::vector<TH1F*> Refill(const std::string& filePath, const std::vector<Request>& requests, std::string& error) const {
+        std::vector<TH1F*> refilled;
+        try {
+            refilled = Fill(filePath, requests);
+        } catch (const std::exception& e) {
+            // RDataFrame reports a missing tree or branch by throwing; the caller falls back to the binned cut
+            error = e.what();
+        }
+        return refilled;
+    }
+
+private:
+    std::string treeName_ = "clusterTree";
+    std::string cutBranch_;
+
+    // Plotted histogram -> tree branch it is filled from
+    std::unordered_map<std::string, std::string> branches_ = {{"hClusterPt", "clusterPt"}, {"hClusterECore", "clusterECore"}};
+
+    // Book one filtered histogram per request and run the shared event loop
+    std::vector<TH1F*> Fill(const std::string& filePath, const std::vector<Request>& requests) const {
+        std::vector<TH1F*> refilled;
+        ROOT::RDataFrame frame(treeName_, filePath);
+
+        // Book everything first; the data is only read when the first result is accessed
+        std::vector<ROOT::RDF::RResultPtr<TH1D>> booked;
+        for (const auto& request : requests) {
+            const std::string& branch = branches_.at(request.histName);
+            const std::string& cutBranch = cutBranch_.empty() ? branch : cutBranch_;
+            const TAxis* axis = request.binning->GetXaxis();
+            std::vector<double> edges(axis->GetNbins() + 1);
+            for (int bin = 1; bin <= axis->GetNbins() + 1; bin++) {
+                edges[bin - 1] = axis->GetBinLowEdge(bin);
+            }
+            ROOT::RDF::TH1DModel model(request.histName.c_str(), request.binning->GetTitle(), axis->GetNbins(), edges.data());
+            booked.push_back(frame.Filter(CutExpression(cutBranch, request.low, request.high)).Histo1D(model, branch));
+        }
+        if (booked.empty()) {
+            return refilled;
+        }
+
+        // Convert to the TH1F type the plotters work with, keeping the stored histogram's name and attributes
+        for (size_t i = 0; i < requests.size(); i++) {
+            const TH1D* filled = booked[i].GetPtr();
+            TH1F* hist = (TH1F*)requests[i].binning->Clone();
+            hist->SetDirectory(nullptr);
+            hist->Reset();
+            hist->Add(filled);
+            refilled.push_back(hist);
+        }
+        return refilled;
+    }
+
+    // Filter expression keeping clusters inside [low, high], compiled once per booked filter
+    static std::string CutExpression(const std::string& branch, double low, double high) {
+        std::ostringstream expression;
+        expression.precision(17);
+        const bool hasLow = low > -std::numeric_limits<double>::infinity();
+        const bool hasHigh = high < std::numeric_limits<double>::infinity();
+        if (hasLow) {
+            expression << branch << " >= " << low;
+        }
+        if (hasHigh) {
+            expression << (hasLow ? " && " : "") << branch << " <= " << high;
+        }
+        return hasLow || hasHigh ? expression.str() : "true";
+    }
+};
+
+#endif // QA_TREE_REFILL_H
@@ -0,0 +1,117 @@
+// Input directory watcher for the EMCal QA watch mode
+
+/*
+   WATCH OVERVIEW:
+   RunWatcher polls the cache's base directory for run directories whose qa.root has appeared since the
+   last poll. A qa.root counts as complete once it has not been modified for settleSeconds, so a file that
+   is still being written is picked up on a later poll rather than half-read. New runs take their SEB
+   count and color from the run list, which is read again whenever the list file changes; a run that is
+   not listed yet is held back until it is. Every run is reported once per session.
+   Polling (one directory listing and one stat per pending run) is used instead of inotify: it also works
+   on the network filesystems the QA output lands on. Remote (root://) base directories cannot be listed.
+*/
+
+#ifndef QA_WATCH_H
+#define QA_WATCH_H
+
+#include <TSystem.h>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include "QARunCache.h"
+#include "QARunCatalog.h"
+
+class RunWatcher {
+public:
+    // runList: CSV run catalog giving the SEB counts of new runs (empty = the default catalog)
+    explicit RunWatcher(const std::string& runList = "") : runList_(runList) {}
+
+    // Seconds a qa.root must stay unmodified before its run is reported
+    void SetSettleTime(long settleSeconds) { settleSeconds_ = settleSeconds; }
+
+    // Report nothing for run from now on (e.g. runs plotted before the watch started)
+    void MarkProcessed(const std::string& run) { done_.insert(run); }
+
+    // Number of runs reported so far
+    size_t NProcessed() const { return done_.size(); }
+
+    // Runs whose qa.root completed since the last poll, in run-number order
+    std::vector<RunInfo> Poll() {
+        std::vector<RunInfo> ready;
+        ReloadRunList();
+        RunHistCache& cache = RunHistCache::Instance();
+        void *dir = gSystem->OpenDirectory(cache.GetBaseDir().c_str());
+        if (!dir) {
+            if (!warned_) {
+                std::cout << "Watch issue: cannot list " << cache.GetBaseDir() << std::endl;
+                warned_ = true;
+            }
+            return ready;
+        }
+        std::vector<std::string> names;
+        while (const char *entry = gSystem->GetDirEntry(dir)) {
+            const std::string name(entry);
+            if (IsRunName(name) && !done_.count(name)) {
+                names.push_back(name);
+            }
+        }
+        gSystem->FreeDirectory(dir);
+        std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b) { return std::atoi(a.c_str()) < std::atoi(b.c_str()); });
+
+        const long now = (long)std::time(nullptr);
+        for (const auto& run : names) {
+            FileStat_t stat;
+            // GetPathInfo returns non-zero while the run has no qa.root yet
+            if (gSystem->GetPathInfo(cache.GetFilePath(run).c_str(), stat) != 0 || now - stat.fMtime < settleSeconds_) {
+                continue;
+            }
+            const RunInfo* info = catalog_.Find(run);
+            if (!info) {
+                if (unlisted_.insert(run).second) {
+                    std::cout << "Run " << run << " is not in the run list yet, waiting for it to be added" << std::endl;
+                }
+                continue;
+            }
+            done_.insert(run);
+            ready.push_back(*info);
+        }
+        return ready;
+    }
+
+private:
+    std::string runList_;           // CSV run catalog, empty for the default catalog
+    long runListTime_ = -1;         // Modification time of runList_ when it was last read
+    RunCatalog catalog_;            // SEB counts and colors of the runs that may be reported
+    long settleSeconds_ = 60;       // Quiet time before a qa.root counts as complete
+    std::set<std::string> done_;    // Runs already reported
+    std::set<std::string> unlisted_;    // Complete runs missing from the run list (told once)
+    bool warned_ = false;           // Whether the unreadable base directory was reported
+
+    // Read the run list on the first poll and again whenever the file changes
+    void ReloadRunList() {
+        if (runList_.empty()) {
+            if (runListTime_ < 0) {
+                catalog_ = RunCatalog::Default();
+                runListTime_ = 0;
+            }
+            return;
+        }
+        FileStat_t stat;
+        if (gSystem->GetPathInfo(runList_.c_str(), stat) != 0 || stat.fMtime == runListTime_) {
+            return;
+        }
+        catalog_ = RunCatalog::FromCSV(runList_);
+        runListTime_ = stat.fMtime;
+    }
+
+    // Run directories are named by their run number
+    static bool IsRunName(const std::string& name) {
+        return !name.empty() && std::all_of(name.begin(), name.end(), [](char c) { return c >= '0' && c <= '9'; });
+    }
+};
+
+#endif // QA_WATCH_H
@@ -1,9 +1,28 @@
 #include <TFile.h>
 #include <TH1F.h>
 #include <TCanvas.h>
+#include <TLegend.h>
 #include <iostream>
-#include <unordered_map>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <limits>
 #include <TROOT.h>
+#include "QARunCache.h"
+#include "QAHistSpec.h"
+#include "QARunCatalog.h"
+#include "QAPlotManifest.h"
+#include "QALogger.h"
+#include "QATiming.h"
+#include "QATreeRefill.h"
+#include "QANormalization.h"
+#include "QAPlotWriter.h"
+#include "QARunFetch.h"
+#include "QARebin.h"
+#include "QAShard.h"
 
 class SinglePlotter {
 public:
@@ -11,59 +30,159 @@ public:
     SinglePlotter(bool normalize, bool applyCut = false, double cutValue = 0.0, const std::vector<std::string>& histToCut = {})
         : normalize_(normalize), applyCut_(applyCut), cutValue_(cutValue), histToCut_(histToCut) {}
     
+    // Keep only bins whose centers lie within [low, high] for the histograms in histToCut
+    // Use -infinity for a pure upper cut and +infinity (the default) for a pure lower cut
+    void SetCutWindow(double low, double high) {
+        cutValue_ = low;
+        cutMax_ = high;
+    }
+    
+    // Cut scan mode: render one plot per lower cut value (each up to the window's upper end) for the histograms in histToCut
+    // Every run and histogram is still read and normalized once; the cut variants are made from copies of it
+    // overlay additionally draws all variants of a plot on one canvas (<hist>_Run_<run>_CutScan.png)
+    void SetCutValues(const std::vector<double>& cutValues, bool overlay = false) {
+        cutValues_ = cutValues;
+        cutOverlay_ = overlay;
+    }
+    
+    // Set the runs to process, walked in run order (defaults to RunCatalog::Default())
+    void SetRunCatalog(const RunCatalog& catalog) {
+        catalog_ = catalog;
+        catalog_.SortByRun();
+        norms_.Clear();
+    }
+    
+    // Per-run normalization factors computed so far (nEvents, SEB count and scale of every processed run)
+    const NormalizationTable& GetNormalizations() const { return norms_; }
+    
+    // Directory the per-histogram output folders live in (with trailing '/')
+    void SetOutputDir(const std::string& outputDir) { outputDir_ = outputDir; }
+    const std::string& GetOutputDir() const { return outputDir_; }
+    
+    // Number of worker threads used to process runs (1 = serial, 0 = one per hardware core)
+    // The workers read, cut and draw in parallel; saving the images is serialized by PlotWriter (see QAPlotWriter.h)
+    void SetNThreads(unsigned nThreads) { nThreads_ = nThreads; }
+    
+    // Image format of the plots (png, pdf, svg, ...) and, for PNGs, the compression level (0-100, -1 = ROOT default)
+    void SetOutputFormat(const std::string& format, int pngCompression = -1) {
+        writer_.SetFormat(format);
+        writer_.SetPngCompression(pngCompression);
+    }
+    
+    // Compress PNGs on nEncoders background threads while the next plots are drawn
+    void SetAsyncEncoding(bool async, unsigned nEncoders = 1) { writer_.SetAsyncEncoding(async, nEncoders); }
+    
+    // Write every run's plot of a histogram as a page of one PDF per histogram (<hist>_AllRuns.pdf)
+    // Pages are added in run order, so this processes the runs on a single worker and disables incremental mode
+    void SetMultiPagePdf(bool multiPage) { writer_.SetMultiPage(multiPage); }
+    
+    // Prefetch mode: read the next run's qa.root on a background thread while the current run is drawn and saved
+    // (per worker thread when several are used), so file latency overlaps with rendering
+    void SetPrefetch(bool prefetch) { prefetch_ = prefetch; }
+    
+    // Incremental mode: skip plots whose qa.root and plot settings are unchanged since they were last saved
+    // useChecksum compares the MD5 of qa.root instead of its size and modification time
+    void SetIncremental(bool incremental, bool useChecksum = false) {
+        incremental_ = incremental;
+        manifest_.SetUseChecksum(useChecksum);
+    }
+    
+    // Console verbosity (quiet/info/debug)
+    void SetLogLevel(LogLevel level) { logLevel_ = level; }
+    
+    // Write a JSON-lines summary (run, histogram, status, nEvents, time) after each pass ("-" = standard output)
+    void SetSummaryFile(const std::string& summaryFile) { summaryFile_ = summaryFile; }
+    
+    // Record per-stage timings of every plot and print a summary table after each pass
+    // csvPath (optional) additionally receives one line per run and histogram
+    void SetTiming(bool timing, const std::string& csvPath = "") {
+        timing_ = timing;
+        timingCsv_ = csvPath;
+    }
+    
+    // Tree refill mode: when a run's qa.root holds the per-cluster tree, the cut histograms are refilled from it
+    // with the cut applied per cluster (in one RDataFrame event loop per run) instead of clearing bins afterwards
+    // nImtThreads: size of ROOT's implicit multi-threading pool used by the event loops (0 = one per hardware core)
+    void SetTreeRefill(bool treeRefill, const std::string& treeName = "clusterTree", unsigned nImtThreads = 0) {
+        treeRefill_ = treeRefill;
+        refiller_.SetTreeName(treeName);
+        nImtThreads_ = nImtThreads;
+    }
+    
+    // Draw at most maxBins merged bins per plot (0 = full resolution); normalization and cuts still use every bin
+    void SetMaxDisplayBins(int maxBins) { maxDisplayBins_ = maxBins; }
+    
     // Method to plot histograms
     // This function will loop through every run and make plots
     void Plot(const std::string& histName, const std::string& title, const std::string& xAxisTitle, const std::string& yAxisTitle) 
     {
         // Header for console output
-        std::cout << "===========================================" << std::endl;
-        std::cout << "Start Plotting for Histogram: " << histName << std::endl;
-        std::cout << "===========================================" << std::endl;
-        
-        // Loop through each run and its SEB (Sub-Event Buffer) count
-        for (const auto& runEntry : runDataMap_) {
-                const std::string& run = runEntry.first;
-                int sebCount = runEntry.second;
-                
-                // Console output for each run
-                std::cout << "-------------------------------------------------" << std::endl;
-                std::cout << "| Processing Run: " << run << std::endl;
-                std::cout << "| SEB Count: " << sebCount << std::endl;
-            
-                // Actual plotting method
-                PlotRun(run, histName, title, xAxisTitle, yAxisTitle, sebCount);
-            
-                // Console output post-processing for each run
-                std::cout << "-------------------------------------------------" << std::endl;
-            }
-            std::cout << "Completed Plotting for Histogram: " << histName << std::endl << std::endl;
+        RunLog log(logLevel_);
+        log.Info() << "===========================================\n";
+        log.Info() << "Start Plotting for Histogram: " << histName << "\n";
+        log.Info() << "===========================================\n";
+        log.Flush();
+        
+        ProcessRuns({{histName, title, xAxisTitle, yAxisTitle}});
+        
+        log.Info() << "Completed Plotting for Histogram: " << histName << "\n\n";
+        log.Flush();
+    }
+    
+    // Method to plot several histograms in one pass
+    // Runs are the outer loop: each run is fetched once and all requested histograms are drawn before moving on
+    void PlotAll(const std::vector<HistSpec>& specs)
+    {
+        // Header for console output
+        RunLog log(logLevel_);
+        log.Info() << "===========================================\n";
+        log.Info() << "Start Plotting for Histograms:";
+        for (const auto& spec : specs) {
+            log.Info() << " " << spec.histName;
         }
+        log.Info() << "\n";
+        log.Info() << "===========================================\n";
+        log.Flush();
+        
+        ProcessRuns(specs);
+        
+        log.Info() << "Completed Plotting for " << specs.size() << " Histograms\n\n";
+        log.Flush();
+    }
 
 private:
     // Private variables to hold settings
     bool normalize_;    // Whether to normalize histogram or not
     bool applyCut_;     // Whether to apply energy cut or not
     double cutValue_;   // Cut value for energy
+    double cutMax_ = std::numeric_limits<double>::infinity();  // Upper end of the energy window (none by default)
     std::vector<std::string> histToCut_;    // List of histograms to apply cut
+    std::vector<double> cutValues_;         // Cut values of a cut scan, empty to use cutValue_ only
+    bool cutOverlay_ = false;               // Whether to also overlay the variants of a cut scan on one canvas
+    unsigned nThreads_ = 1;     // Number of worker threads for run processing
+    bool prefetch_ = false;     // Whether to read the next run in the background while the current one renders
+    bool incremental_ = false;  // Whether to skip plots that are already up to date
+    PlotManifest manifest_;     // Record of the inputs and settings behind every saved plot
+    LogLevel logLevel_ = LogLevel::kInfo;   // Console verbosity
+    std::string summaryFile_;   // Where to write the per-plot summary, empty for none
+    PlotSummaryLog summary_;    // Per-plot outcomes of the current pass
+    bool timing_ = false;       // Whether to record per-stage timings
+    std::string timingCsv_;     // Where to write the timing records, empty for none
+    TimingReport timingReport_; // Per-stage timings of the current pass
+    bool treeRefill_ = false;   // Whether to refill cut histograms from the cluster tree when it is present
+    unsigned nImtThreads_ = 0;  // Implicit multi-threading pool size for the tree refills
+    ClusterTreeRefiller refiller_;  // Tree and branch names of the refill
+    PlotWriter writer_;         // Output format and encoding of the plots
+    int maxDisplayBins_ = 0;    // Most bins drawn per plot, 0 = draw every bin
+    
+    // Runs to process with their SEB (Sub-Event Buffer) counts
+    RunCatalog catalog_ = RunCatalog::Default();
+    
+    // Normalization of each run in catalog_, computed once per run
+    NormalizationTable norms_;
     
-    // Map containing run numbers and corresponding SEB (Sub-Event Buffer) counts
-    std::unordered_map<std::string, int> runDataMap_ = {
-        // Run numbers are keys and SEB counts are values
-        {"21813", 7},
-        {"21796", 8},
-        {"21615", 8},
-        {"21599", 8},
-        {"21598", 8},
-        {"21891", 7},
-        {"22979", 5},
-        {"22950", 5},
-        {"22949", 5},
-        {"22951", 5},
-        {"22982", 5},
-        {"21518", 8},
-        {"21520", 8},
-        {"21889", 7}
-    };
+    // Directory holding one sub-folder per histogram (see GetOutputPath)
+    std::string outputDir_ = "/Users/patsfan753/Desktop/QA_EMCal/Individual_Plot_Output/";
     
     // Helper function to get the output path for each histogram
     std::string GetOutputPath(const std::string& histName)
@@ -73,97 +192,596 @@ private:
          */
         
         // Map histogram name to output directory
-        if (histName == "hClusterChi") return "/Users/patsfan753/Desktop/QA_EMCal/Individual_Plot_Output/Cluster_Chi/";
-        if (histName == "hClusterPt") return "/Users/patsfan753/Desktop/QA_EMCal/Individual_Plot_Output/Cluster_pt/";
-        if (histName == "hClusterECore") return "/Users/patsfan753/Desktop/QA_EMCal/Individual_Plot_Output/ECore/";
-        if (histName == "hTotalCaloE") return "/Users/patsfan753/Desktop/QA_EMCal/Individual_Plot_Output/Total_Calo_Energy/";
-        if (histName == "hTotalMBD") return "/Users/patsfan753/Desktop/QA_EMCal/Individual_Plot_Output/MBD_charge/";
-        return "";
+        if (histName == "hClusterChi") return outputDir_ + "Cluster_Chi/";
+        if (histName == "hClusterPt") return outputDir_ + "Cluster_pt/";
+        if (histName == "hClusterECore") return outputDir_ + "ECore/";
+        if (histName == "hTotalCaloE") return outputDir_ + "Total_Calo_Energy/";
+        if (histName == "hTotalMBD") return outputDir_ + "MBD_charge/";
+        return outputDir_;
     }
     
-    // Helper function to apply energy cut
-    void ApplyEnergyCut(TH1F* hist) {
-        std::cout << "| Applying Energy Cut..." << std::endl;
+    // Full path of the plot for one histogram and run; tag distinguishes the plots of a cut scan
+    std::string GetOutputFile(const std::string& histName, const std::string& run, const std::string& tag = "")
+    {
+        return GetOutputPath(histName) + histName + "_Run_" + run + tag + "." + writer_.GetFormat();
+    }
+    
+    // Multi-page document holding the plots of one histogram for every run (empty outside multi-page mode)
+    std::string GetDocumentFile(const std::string& histName, const std::string& tag = "")
+    {
+        return writer_.IsMultiPage() ? GetOutputPath(histName) + histName + tag + "_AllRuns.pdf" : "";
+    }
+    
+    // Incremental skipping works per image file, so it is off while plots go into multi-page documents
+    bool Incremental() const { return incremental_ && !writer_.IsMultiPage(); }
+    
+    // Whether the energy cut is applied to this histogram
+    bool CutApplies(const std::string& histName) const
+    {
+        return applyCut_ && std::find(histToCut_.begin(), histToCut_.end(), histName) != histToCut_.end();
+    }
+    
+    // Lower cut values rendered for this histogram (empty if it is not cut)
+    std::vector<double> CutValues(const std::string& histName) const
+    {
+        if (!CutApplies(histName)) {
+            return {};
+        }
+        return cutValues_.empty() ? std::vector<double>{cutValue_} : cutValues_;
+    }
+    
+    // File name tag of one cut variant (none outside a cut scan, so single-cut plots keep their names)
+    std::string CutTag(double cut) const
+    {
+        return cutValues_.empty() ? "" : Form("_Cut_%gGeV", cut);
+    }
+    
+    // Every plot file produced for one histogram and run
+    std::vector<std::string> GetOutputFiles(const std::string& histName, const std::string& run)
+    {
+        std::vector<std::string> files;
+        const std::vector<double> cuts = CutValues(histName);
+        if (cuts.empty()) {
+            files.push_back(GetOutputFile(histName, run));
+        }
+        for (double cut : cuts) {
+            files.push_back(GetOutputFile(histName, run, CutTag(cut)));
+        }
+        if (cutOverlay_ && cuts.size() > 1) {
+            files.push_back(GetOutputFile(histName, run, "_CutScan"));
+        }
+        return files;
+    }
+    
+    // Refill part of a plot's stamp: "off" when the plot uses the binned cut by design, otherwise the tree and
+    // branches the refill reads, prefixed with "fallback:" when the refill was tried but the binned cut was used
+    // (no tree in the file, or it could not be read)
+    std::string RefillTag(const std::string& histName, bool fallback) const
+    {
+        if (!treeRefill_ || !CutApplies(histName) || !refiller_.Supports(histName)) {
+            return "off";
+        }
+        return std::string(fallback ? "fallback:" : "") + refiller_.GetTreeName() + ":" + refiller_.GetBranch(histName) + ":"
+            + refiller_.GetCutBranch();
+    }
+    
+    // Manifest stamp of one plot: the input file's stamp plus every setting that changes the image, including
+    // the spec's title and axis labels and the image format and compression; refillTag (see RefillTag) records
+    // whether the cut came from the cluster tree
+    std::string PlotStamp(const std::string& inputStamp, const HistSpec& spec, const std::string& refillTag) const
+    {
+        const std::string& histName = spec.histName;
+        std::ostringstream stamp;
+        stamp.precision(10);
+        stamp << inputStamp << "|normalize=" << normalize_ << "|cut=";
+        const std::vector<double> cuts = CutValues(histName);
+        for (double cut : cuts) {
+            stamp << cut << ",";
+        }
+        if (cuts.empty()) {
+            stamp << "none";
+        } else {
+            stamp << ":" << cutMax_ << "|overlay=" << cutOverlay_;
+        }
+        stamp << "|displayBins=" << maxDisplayBins_ << "|refill=" << refillTag << "|format=" << writer_.GetFormat() << ":"
+              << writer_.GetPngCompression() << "|labels=" << spec.title << ";" << spec.xAxisTitle << ";" << spec.yAxisTitle;
+        return stamp.str();
+    }
+    
+    // Loop through each run and its SEB (Sub-Event Buffer) count, serially or on a pool of worker threads
+    void ProcessRuns(const std::vector<HistSpec>& specs)
+    {
+        const std::vector<RunInfo>& runs = catalog_.Runs();
+        summary_.Clear();
+        timingReport_.Clear();
+        
+        unsigned nThreads = nThreads_ ? nThreads_ : std::thread::hardware_concurrency();
+        nThreads = std::max(1u, std::min<unsigned>(nThreads, runs.size()));
+        if (writer_.IsMultiPage()) {
+            nThreads = 1;
+        }
+        
+        // The tree event loops run on ROOT's thread pool, shared by all run workers
+        if (treeRefill_ && !ROOT::IsImplicitMTEnabled()) {
+            ROOT::EnableImplicitMT(nImtThreads_);
+        }
+        
+        // Background encoders draw on ROOT's image library concurrently with the plot loop
+        if (writer_.IsAsync()) {
+            ROOT::EnableThreadSafety();
+        }
+        
+        if (nThreads == 1 && !prefetch_) {
+            TCanvas* canvas = NewWorkerCanvas();
+            for (const auto& info : runs) {
+                RunLog log(logLevel_);
+                ProcessRun(info, specs, log, canvas);
+                log.Flush();
+            }
+            writer_.ClosePages(canvas);
+            delete canvas;
+        } else {
+            // Every run is independent: each worker opens its own files and draws on its own canvas
+            // (prefetch threads read files too, so thread safety is needed even for a single worker)
+            ROOT::EnableThreadSafety();
+            if (logLevel_ >= LogLevel::kInfo && nThreads > 1) {
+                std::cout << "| Processing " << runs.size() << " runs on " << nThreads << " threads\n";
+            }
+            
+            // Per-run log buffers, printed in run order as soon as every earlier run has finished
+            std::vector<RunLog> logs;
+            logs.reserve(runs.size());
+            for (size_t i = 0; i < runs.size(); i++) {
+                logs.emplace_back(logLevel_);
+            }
+            std::vector<bool> finished(runs.size(), false);
+            size_t nPrinted = 0;
+            std::mutex printMutex;
+            std::atomic<size_t> nextRun(0);
+            
+            // With prefetching, a worker claims its next run before processing the current one and reads it meanwhile
+            auto worker = [&]() {
+                TCanvas* canvas = NewWorkerCanvas();
+                size_t i = nextRun++;
+                std::future<bool> prefetch;
+                while (i < runs.size()) {
+                    FinishPrefetch(prefetch, runs[i].run, Timing());
+                    size_t next = prefetch_ ? nextRun++ : runs.size();
+                    if (next < runs.size()) {
+                        prefetch = PrefetchRun(runs[next].run);
+                    }
+                    
+                    ProcessRun(runs[i], specs, logs[i], canvas);
+                    
+                    {
+                        std::lock_guard<std::mutex> lock(printMutex);
+                        finished[i] = true;
+                        while (nPrinted < runs.size() && finished[nPrinted]) {
+                            logs[nPrinted].Flush();
+                            nPrinted++;
+                        }
+                    }
+                    i = prefetch_ ? next : nextRun++;
+                }
+                // Only a single worker runs in multi-page mode, so only it can have documents open
+                writer_.ClosePages(canvas);
+                delete canvas;
+            };
+            
+            if (nThreads == 1) {
+                worker();
+            } else {
+                std::vector<std::thread> workers;
+                for (unsigned t = 0; t < nThreads; t++) {
+                    workers.emplace_back(worker);
+                }
+                for (auto& w : workers) {
+                    w.join();
+                }
+            }
+        }
         
-        // Loop over each bin
-        for (int bin = 1; bin <= hist->GetNbinsX(); bin++) {
-            if (hist->GetBinCenter(bin) < cutValue_) {
-                hist->SetBinContent(bin, 0);  // set the bin content to zero below the cut value
+        // Every image must be on disk before the manifest records it
+        writer_.Flush();
+        manifest_.Save();
+        summary_.PrintFailures();
+        if (!summaryFile_.empty()) {
+            summary_.Write(summaryFile_);
+        }
+        if (timing_) {
+            timingReport_.Print();
+            RunHistCache::Instance().PrintStats();
+            if (!timingCsv_.empty()) {
+                timingReport_.WriteCSV(timingCsv_);
             }
         }
-        std::cout << "| Energy Cut Applied for bins below " << cutValue_ << " GeV" << std::endl;
     }
     
-    // Method to plot a single run
-    void PlotRun(const std::string& run, const std::string& histName, const std::string& title, const std::string& xAxisTitle, const std::string& yAxisTitle, int sebCount)
+    // Plot every requested histogram for one run, writing the run's console output to log
+    // canvas is the calling worker's canvas, reused for every plot of the run
+    void ProcessRun(const RunInfo& info, const std::vector<HistSpec>& specs, RunLog& log, TCanvas* canvas)
     {
+        const std::string& run = info.run;
+        const int sebCount = info.sebCount;
         
-        /*
-         ENSURE TO CHANGE PATH TO ROOT FILES HERE
-         */
+        // Console output for each run
+        log.Info() << "-------------------------------------------------\n";
+        log.Info() << "| Processing Run: " << run << "\n";
+        log.Debug() << "| SEB Count: " << sebCount << "\n";
         
-        // Directory where ROOT files are located
-        const char *baseDir = "/Users/patsfan753/Desktop/QA_EMCal/rootOutput/";
-        std::string filePath = baseDir + run + "/qa.root";  // Construct the full file path
+        // In incremental mode, plots whose input file and settings are unchanged are skipped
+        // The stamp is taken from the file that actually supplies the run (the consolidated file or qa.root)
+        std::string inputStamp;
+        std::vector<const HistSpec*> toPlot;
+        if (Incremental()) {
+            RunHistCache& cache = RunHistCache::Instance();
+            const std::string source = cache.GetSourcePath(run);
+            inputStamp = manifest_.InputStamp(source);
+            if (!inputStamp.empty() && source != cache.GetFilePath(run)) {
+                inputStamp = "source:" + source + "," + inputStamp;
+            }
+        }
+        for (const auto& spec : specs) {
+            if (Incremental() && IsCurrent(spec, run, inputStamp)) {
+                log.Info() << "| Up to date, skipping histogram: " << spec.histName << "\n";
+                summary_.Add({run, spec.histName, "skipped", -1, 0, ""});
+            } else {
+                toPlot.push_back(&spec);
+            }
+        }
         
-        TFile *file = TFile::Open(filePath.c_str());
-        if (!file || file->IsZombie()) {
-            std::cout << "File issue for run: " << run << std::endl;
-            return;
+        // One read of the run's file and its hNClusters count serves every histogram
+        if (!toPlot.empty()) {
+            auto start = std::chrono::steady_clock::now();
+            std::string status;
+            std::string error;
+            const RunHistCache::RunEntry* cached = FetchRun(run, log, status, error);
+            const RunNormalization norm = cached ? norms_.Get(info) : RunNormalization();
+            std::unordered_map<std::string, std::vector<TH1F*>> refilled;
+            if (cached && treeRefill_) {
+                refilled = RefillFromTree(run, toPlot, *cached, log);
+            }
+            for (const HistSpec* spec : toPlot) {
+                if (cached) {
+                    auto rit = refilled.find(spec->histName);
+                    std::vector<TH1F*> source = rit == refilled.end() ? std::vector<TH1F*>() : rit->second;
+                    status = PlotRun(run, *spec, norm, log, canvas, source) ? "ok" : "hist_error";
+                    error = status == "ok" ? "" : spec->histName + " not found";
+                    if (status == "ok" && Incremental()) {
+                        const std::string stamp = PlotStamp(inputStamp, *spec, RefillTag(spec->histName, source.empty()));
+                        for (const auto& file : GetOutputFiles(spec->histName, run)) {
+                            manifest_.Update(file, stamp);
+                        }
+                    }
+                }
+                auto stop = std::chrono::steady_clock::now();
+                double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+                summary_.Add({run, spec->histName, status, norm.nEvents, ms, error});
+                start = stop;
+            }
         }
         
-        // Open ROOT file for the given run
-        TH1F *hist = (TH1F*)file->Get(histName.c_str());
+        // Console output post-processing for each run
+        log.Info() << "-------------------------------------------------\n";
+    }
+    
+    // Whether every plot of a histogram and run is up to date in the manifest
+    // A plot that fell back to the binned cut stays current: with an unchanged input file the refill would fall back again
+    bool IsCurrent(const HistSpec& spec, const std::string& run, const std::string& inputStamp)
+    {
+        const std::vector<std::string> files = GetOutputFiles(spec.histName, run);
+        for (bool fallback : {false, true}) {
+            const std::string stamp = PlotStamp(inputStamp, spec, RefillTag(spec.histName, fallback));
+            bool current = true;
+            for (const auto& file : files) {
+                if (!manifest_.IsCurrent(file, stamp)) {
+                    current = false;
+                    break;
+                }
+            }
+            if (current) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // Refill the cut histograms of one run from its cluster tree, every cut value of every histogram in one event loop
+    // Returns histogram name -> one refilled histogram per cut value (owned by the caller); histograms that cannot
+    // be refilled are left out and fall back to the binned cut
+    std::unordered_map<std::string, std::vector<TH1F*>> RefillFromTree(const std::string& run, const std::vector<const HistSpec*>& specs,
+                                                                       const RunHistCache::RunEntry& runEntry, RunLog& log)
+    {
+        std::unordered_map<std::string, std::vector<TH1F*>> refilled;
+        if (!runEntry.keys.count(refiller_.GetTreeName())) {
+            log.Debug() << "| No " << refiller_.GetTreeName() << " in file, using binned energy cut\n";
+            return refilled;
+        }
+        
+        // The stored histograms provide the binning of the refilled ones
+        std::vector<ClusterTreeRefiller::Request> requests;
+        std::vector<TH1F*> binnings;
+        for (const HistSpec* spec : specs) {
+            if (!CutApplies(spec->histName) || !refiller_.Supports(spec->histName)) {
+                continue;
+            }
+            TH1F* binning = RunHistCache::Instance().CloneHist(run, spec->histName, spec->histName + "_" + run);
+            if (!binning) {
+                continue;
+            }
+            binnings.push_back(binning);
+            for (double cut : CutValues(spec->histName)) {
+                requests.push_back({spec->histName, binning, cut, cutMax_});
+            }
+        }
+        if (requests.empty()) {
+            return refilled;
+        }
+        
+        StageTimer timer;
+        std::string error;
+        std::vector<TH1F*> hists = refiller_.Refill(RunHistCache::Instance().GetFilePath(run), requests, error);
+        for (size_t i = 0; i < hists.size(); i++) {
+            refilled[requests[i].histName].push_back(hists[i]);
+        }
+        for (TH1F* binning : binnings) {
+            delete binning;
+        }
+        if (!error.empty()) {
+            log.Error() << "Tree issue for run: " << run << " (" << error << "), using binned energy cut\n";
+        } else {
+            log.Debug() << "| Refilled " << hists.size() << " histograms from " << refiller_.GetTreeName() << "\n";
+        }
+        
+        // One event loop serves every refilled histogram of the run, so it is timed once per run
+        if (timing_) {
+            StageRecord record;
+            record.run = run;
+            record.histName = "*";
+            record.ms[kStageCut] = timer.Lap();
+            timingReport_.Add(record);
+        }
+        return refilled;
+    }
+    
+    // Helper function to apply energy cut
+    // Zeroes the contents of the in-range bins whose centers lie outside [low, high], with the same statistics
+    // result as setting each of them to 0 with SetBinContent: underflow, overflow and the Sumw2 errors are left
+    // as they are, the moments follow the remaining bin contents and every cleared bin counts as one entry.
+    // Bin edges are searched once per cut (a binary search on variable-bin axes) and the rejected bins, which
+    // always form a prefix and a suffix of the bin range, are cleared in one block each.
+    void ApplyEnergyCut(TH1F* hist, double low, double high, RunLog& log) {
+        log.Debug() << "| Applying Energy Cut...\n";
+        
+        const TAxis* axis = hist->GetXaxis();
+        const int nBins = hist->GetNbinsX();
+        
+        // First bin kept by the lower cut (bins 1 .. firstKept-1 are cleared)
+        int firstKept = 1;
+        if (low > -std::numeric_limits<double>::infinity()) {
+            firstKept = std::min(std::max(axis->FindFixBin(low), 1), nBins + 1);
+            if (firstKept <= nBins && axis->GetBinCenter(firstKept) < low) {
+                firstKept++;
+            }
+        }
+        
+        // Last bin kept by the upper cut (bins lastKept+1 .. nBins are cleared)
+        int lastKept = nBins;
+        if (high < std::numeric_limits<double>::infinity()) {
+            lastKept = std::max(std::min(axis->FindFixBin(high), nBins), 0);
+            if (lastKept >= 1 && axis->GetBinCenter(lastKept) > high) {
+                lastKept--;
+            }
+        }
+        
+        const double entries = hist->GetEntries();
+        int nCleared = ClearBins(hist, 1, firstKept);
+        nCleared += ClearBins(hist, std::max(lastKept + 1, firstKept), nBins + 1);
+        // SetBinContent drops the stored sums (moments come from the bin contents) and adds one entry per call
+        hist->ResetStats();
+        hist->SetEntries(entries + nCleared);
+        
+        if (high == std::numeric_limits<double>::infinity()) {
+            log.Debug() << "| Energy Cut Applied for bins below " << low << " GeV\n";
+        } else {
+            log.Debug() << "| Energy Cut Applied for bins outside [" << low << ", " << high << "] GeV\n";
+        }
+    }
+    
+    // Zero the bin contents over the half-open bin range [begin, end); returns the number of bins cleared
+    static int ClearBins(TH1F* hist, int begin, int end) {
+        if (begin >= end) {
+            return 0;
+        }
+        Float_t* content = hist->GetArray();
+        std::fill(content + begin, content + end, 0.f);
+        return end - begin;
+    }
+    
+    // Timing report receiving the file reads, nullptr when timing is off
+    TimingReport* Timing() { return timing_ ? &timingReport_ : nullptr; }
+    
+    // Fetch a run from the shared cache (its qa.root is only opened the first time), nullptr if unusable
+    // status and error receive the summary status and reason of an unusable run
+    const RunHistCache::RunEntry* FetchRun(const std::string& run, RunLog& log, std::string& status, std::string& error)
+    {
+        const RunHistCache::RunEntry& cached = FetchCachedRun(run, Timing());
+        
+        if (!cached.fileOk) {
+            log.Error() << "File issue for run: " << run << " (" << cached.error << ")\n";
+            status = "file_error";
+            error = cached.error;
+            return nullptr;
+        }
+        if (cached.attempts > 1) {
+            log.Info() << "| Opened after " << cached.attempts << " attempts\n";
+        }
+        // Number of clusters histogram (filled once per event) is needed for normalization
+        if (cached.nEvents < 0) {
+            log.Error() << "Histogram issue for run: " << run << "\n";
+            status = "hist_error";
+            error = "hNClusters not found";
+            return nullptr;
+        }
+        return &cached;
+    }
+    
+    // Method to plot a single run, returns whether the plots were saved
+    // refilled (optional) holds the histograms already refilled from the cluster tree, one per cut value with the cut
+    // applied; PlotRun takes ownership
+    bool PlotRun(const std::string& run, const HistSpec& spec, const RunNormalization& norm, RunLog& log, TCanvas* canvas,
+                 const std::vector<TH1F*>& refilled = {})
+    {
+        const std::string& histName = spec.histName;
+        const std::vector<double> cuts = CutValues(histName);
+        StageRecord timing;
+        timing.run = run;
+        timing.histName = histName;
+        StageTimer timer;
         
-        // Extract histogram of number of clusters for normalization
-        TH1F *hNClusters = (TH1F*)file->Get("hNClusters");
-        if (!hist || !hNClusters) {
-            std::cout << "Histogram issue for run: " << run << std::endl;
-            return;
+        // Private copy of the histogram, so normalization and cuts never touch the cached one
+        TH1F *hist = nullptr;
+        if (refilled.empty()) {
+            hist = RunHistCache::Instance().CloneHist(run, histName, histName + "_" + run);
+            if (!hist) {
+                log.Error() << "Histogram issue for run: " << run << "\n";
+                return false;
+            }
         }
+        timing.ms[kStageGet] = timer.Lap();
 
-        // Apply normalization if set to true
+        // Apply normalization if set to true (once, before the cut variants are made)
         if (normalize_) {
-            //get number of events from number of clusters histogram (filled once per event)
-            int nEvents = hNClusters->GetEntries();
-            Normalize(hist, nEvents, sebCount);
-            std::cout << "| Normalized using nEvents: " << nEvents << " and SEB count: " << sebCount << std::endl;
+            // nEvents (from the number of clusters histogram, filled once per event) and SEB count come from the run's table entry
+            if (hist) {
+                ApplyNormalization(hist, norm);
+            }
+            for (TH1F* h : refilled) {
+                ApplyNormalization(h, norm);
+            }
+            log.Debug() << "| Normalized using nEvents: " << (long long)norm.nEvents << " and SEB count: " << norm.sebCount << "\n";
         } else {
-            std::cout << "| No normalization applied." << std::endl;
+            log.Debug() << "| No normalization applied.\n";
         }
+        timing.ms[kStageNormalize] = timer.Lap();
         
-        // Apply energy cut if necessary
-        if (applyCut_ && std::find(histToCut_.begin(), histToCut_.end(), histName) != histToCut_.end()) {
-            ApplyEnergyCut(hist);
+        // Histograms to draw: the plain histogram, or one variant per cut value
+        // (a refilled histogram already has its cut; otherwise each variant is a cheap copy with bins cleared)
+        std::vector<TH1F*> variants;
+        if (!refilled.empty()) {
+            variants = refilled;
+            log.Debug() << "| Energy cut applied per cluster from " << refiller_.GetTreeName() << "\n";
+        } else if (cuts.empty()) {
+            variants.push_back(hist);
+            log.Debug() << "| No energy cut applied for histogram: " << histName << "\n";
+        } else if (cuts.size() == 1) {
+            ApplyEnergyCut(hist, cuts[0], cutMax_, log);
+            variants.push_back(hist);
         } else {
-            std::cout << "| No energy cut applied for histogram: " << histName << std::endl;
+            for (double cut : cuts) {
+                TH1F* variant = (TH1F*)hist->Clone(Form("%s_%s_cut%g", histName.c_str(), run.c_str(), cut));
+                variant->SetDirectory(nullptr);
+                ApplyEnergyCut(variant, cut, cutMax_, log);
+                variants.push_back(variant);
+            }
+            delete hist;
+        }
+        // Coarser copies for drawing only, once everything above has used the full resolution
+        for (TH1F*& variant : variants) {
+            variant = DownsampleForDisplay(variant, maxDisplayBins_);
         }
+        timing.ms[kStageCut] = timer.Lap();
         
-        // Create and save canvas
-        TCanvas* c = new TCanvas(Form("c_%s_%s", histName.c_str(), run.c_str()), "", 800, 600);
-        c->SetLogy();
-        hist->SetLineWidth(2);
+        // Draw and save each variant on the worker's canvas
+        for (size_t i = 0; i < variants.size(); i++) {
+            TH1F* variant = variants[i];
+            const std::string tag = cuts.empty() ? "" : CutTag(cuts[i]);
+            ResetCanvas(canvas);
+            variant->SetLineWidth(2);
+            
+            // Set plot titles and labels
+            if (tag.empty()) {
+                variant->SetTitle(Form("%s (Run: %s)", spec.title.c_str(), run.c_str()));
+            } else {
+                variant->SetTitle(Form("%s (Run: %s, Cut: %g GeV)", spec.title.c_str(), run.c_str(), cuts[i]));
+            }
+            variant->GetXaxis()->SetTitle(spec.xAxisTitle.c_str());
+            variant->GetYaxis()->SetTitle(spec.yAxisTitle.c_str());
+            variant->Draw("HIST");
+            timing.ms[kStageDraw] += timer.Lap();
+            const std::string outputFile = GetOutputFile(histName, run, tag);
+            const std::string document = GetDocumentFile(histName, tag);
+            writer_.Save(canvas, outputFile, document);
+            timing.ms[kStageSave] += timer.Lap();
+            log.Info() << "| Saved plot for histogram: " << histName << " and run: " << run << " at path: "
+                       << (document.empty() ? outputFile : document) << "\n";
+        }
         
-        // Set plot titles and labels
-        hist->SetTitle(Form("%s (Run: %s)", title.c_str(), run.c_str()));
-        hist->GetXaxis()->SetTitle(xAxisTitle.c_str());
-        hist->GetYaxis()->SetTitle(yAxisTitle.c_str());
-        hist->Draw("HIST");
-        c->SaveAs(Form("%s%s_Run_%s.png", GetOutputPath(histName).c_str(), histName.c_str(), run.c_str()));
-        std::cout << "| Saved plot for histogram: " << histName << " and run: " << run << " at path: " << Form("%s%s_Run_%s.png", GetOutputPath(histName).c_str(), histName.c_str(), run.c_str()) << std::endl;
+        // All cut variants of a scan on one canvas
+        if (cutOverlay_ && variants.size() > 1) {
+            SaveCutOverlay(run, spec, cuts, variants, canvas, timing, timer, log);
+        }
         
-        // Cleanup
-        delete c;
-        file->Close();
-        delete file;
+        // Cleanup: the canvas only references the histograms, so it is cleared before they are deleted
+        canvas->Clear();
+        for (TH1F* variant : variants) {
+            delete variant;
+        }
+        if (timing_) {
+            timingReport_.Add(timing);
+        }
+        return true;
     }
     
-    // Function to normalize histogram based on number of events and SEB numbers
-    void Normalize(TH1F* h, int nEvents, int nSEBs) {
-        if (nEvents > 0 && nSEBs > 0) {
-            h->Scale(1.0 / (nEvents * nSEBs));
+    // Draw the cut variants of one histogram and run on a single canvas with a legend
+    void SaveCutOverlay(const std::string& run, const HistSpec& spec, const std::vector<double>& cuts, const std::vector<TH1F*>& variants,
+                        TCanvas* canvas, StageRecord& timing, StageTimer& timer, RunLog& log)
+    {
+        static const Color_t colors[] = {kBlack, kBlue, kRed, kGreen+2, kMagenta, kOrange+7, kCyan+3, kViolet+1};
+        const int nColors = sizeof(colors) / sizeof(colors[0]);
+        
+        ResetCanvas(canvas);
+        TLegend* leg = new TLegend(0.6, 0.6, 0.88, 0.88);
+        for (size_t i = 0; i < variants.size(); i++) {
+            variants[i]->SetLineColor(colors[i % nColors]);
+            if (i == 0) {
+                variants[i]->SetTitle(Form("%s (Run: %s, Cut Scan)", spec.title.c_str(), run.c_str()));
+                variants[i]->Draw("HIST");
+            } else {
+                variants[i]->Draw("HIST SAME");
+            }
+            leg->AddEntry(variants[i], Form("Cut: %g GeV", cuts[i]), "l");
         }
+        leg->Draw();
+        timing.ms[kStageDraw] += timer.Lap();
+        const std::string outputFile = GetOutputFile(spec.histName, run, "_CutScan");
+        const std::string document = GetDocumentFile(spec.histName, "_CutScan");
+        writer_.Save(canvas, outputFile, document);
+        timing.ms[kStageSave] += timer.Lap();
+        log.Info() << "| Saved cut scan overlay for histogram: " << spec.histName << " and run: " << run << " at path: "
+                   << (document.empty() ? outputFile : document) << "\n";
+        canvas->Clear();
+        delete leg;
+    }
+    
+    // A pre-configured canvas for one worker, reused for every plot it makes
+    // Canvases are numbered so that workers (and plotters) never share a name in gROOT's list of canvases
+    static TCanvas* NewWorkerCanvas()
+    {
+        static std::atomic<int> nCanvases(0);
+        TCanvas* canvas = new TCanvas(Form("cSingle_%d", nCanvases++), "", 800, 600);
+        canvas->SetLogy();
+        return canvas;
+    }
+    
+    // Remove the previous plot from a worker canvas and make it the current pad for the next Draw()
+    static void ResetCanvas(TCanvas* canvas)
+    {
+        canvas->Clear();
+        canvas->cd();
+        canvas->SetLogy();
     }
+    
 };
 
 std::vector<std::string> AskHistogramToCut() {
@@ -257,64 +875,177 @@ bool AskApplyCut() {
 }
 
 
-void SinglePlotGenerator() {
-    // Call AskApplyCut() to determine if an energy cut should be applied.
-    bool applyCut = AskApplyCut();
-    
-    // Declare a vector to store the histogram names to which the cut will be applied.
-    std::vector<std::string> histToCut;
-
-    // Declare a variable to store the energy cut value.
-    double cutValue = 0;
+// Struct to hold every setting of a SinglePlotGenerator pass, so a pass can run without any prompts
+struct SinglePlotConfig {
+    bool normalize = true;                  // Normalize by number of events and SEB count
+    bool applyCut = false;                  // Apply the minimum cluster energy cut
+    double cutValue = 0.0;                  // Energy cut value (GeV)
+    double cutMaxValue = std::numeric_limits<double>::infinity();  // Optional upper end of the energy window (GeV)
+    std::vector<std::string> histToCut;     // Histograms the energy cut is applied to
+    int nThreads = 1;                       // Worker threads for run processing (0 = one per core)
+    std::string runList;                    // Optional CSV run catalog, empty for the default runs
+    int minRun = 0;                         // Only runs from this run number on, 0 = no lower limit
+    int maxRun = 0;                         // Only runs up to this run number, 0 = no upper limit
+    bool goodOnly = false;                  // Only the runs flagged good in the catalog
+    std::string dbUrl;                      // Run database (e.g. mysql://host/db) queried instead of runList, empty for none
+    std::string dbUser;                     // Run database user
+    std::string dbPassword;                 // Run database password
+    std::string dbQuery;                    // Query returning run, sebCount and (optionally) a good-run flag
+    std::string inputDir;                   // Directory or URL (root://...) holding <run>/qa.root, empty for the default
+    std::string outputDir;                  // Directory holding the per-histogram output folders, empty for the default
+    bool incremental = false;               // Only re-render plots whose input or settings changed
+    LogLevel logLevel = LogLevel::kInfo;    // Console verbosity
+    std::string summaryFile;                // Optional JSON-lines plot summary ("-" = standard output)
+    bool timing = false;                    // Print a per-stage timing table after the pass
+    bool prefetch = false;                  // Read the next run in the background while the current one renders
+    int openTimeout = 0;                    // Seconds before an open of a (remote) qa.root gives up, 0 = no timeout
+    int openRetries = 0;                    // Extra attempts at opening a qa.root that failed to open
+    double memoryBudgetMB = 0;              // Memory cap of the histogram cache in MB (least recently used evicted first), 0 = unlimited
+    std::string format = "png";             // Image format of the plots (png, pdf, svg, ...)
+    int pngCompression = -1;                // PNG compression level 0-100, -1 for ROOT's default
+    unsigned nEncoders = 0;                 // Background PNG encoder threads, 0 to encode on the plotting thread
+    bool multiPagePdf = false;              // One multi-page PDF per histogram instead of one file per plot
+    std::string timingCsv;                  // Optional CSV with the per-stage timing of every plot
+    bool treeRefill = false;                // Refill cut histograms from the cluster tree when qa.root has one
+    std::string treeName = "clusterTree";   // Name of the per-cluster tree
+    std::vector<double> cutValues;          // Cut scan: lower cut values rendered side by side (replaces cutValue)
+    bool cutOverlay = false;                // Cut scan: also overlay all cut values on one canvas
+    std::string cacheFile;                  // Consolidated cache file, empty for <inputDir>/qa_consolidated.root if present
+    bool checkStale = false;                // Read runs reprocessed since the consolidation from qa.root (one stat per run)
+    int maxDisplayBins = 0;                 // Most bins drawn per plot (merged for display only), 0 = every bin
+    std::string shard;                      // "i/N": only plot the i-th of N run subsets and write its partial file (see QAShard.h)
+    std::string partialDir;                 // Directory of the shard partial files, empty for <inputDir>/qa_shards/
+};
 
-    // If an energy cut should be applied, get further details.
-    if (applyCut) {
-        histToCut = AskHistogramToCut(); // Get the list of histograms for the cut.
-        cutValue = AskEnergyCutValue();  // Get the energy cut value.
-    }
-    
+// Run one plotting pass with the given settings
+void RunSinglePlots(const SinglePlotConfig& config) {
     // Create a SinglePlotter object and initialize it with relevant parameters.
-    SinglePlotter plotter(true, applyCut, cutValue, histToCut);
+    SinglePlotter plotter(config.normalize, config.applyCut, config.cutValue, config.histToCut);
+    plotter.SetCutWindow(config.cutValue, config.cutMaxValue);
+    plotter.SetCutValues(config.cutValues, config.cutOverlay);
+    plotter.SetNThreads(config.nThreads);
+    plotter.SetPrefetch(config.prefetch);
+    plotter.SetOutputFormat(config.format, config.pngCompression);
+    plotter.SetAsyncEncoding(config.nEncoders > 0, config.nEncoders);
+    plotter.SetMultiPagePdf(config.multiPagePdf);
+    plotter.SetIncremental(config.incremental);
+    plotter.SetLogLevel(config.logLevel);
+    plotter.SetSummaryFile(config.summaryFile);
+    plotter.SetTiming(config.timing, config.timingCsv);
+    plotter.SetTreeRefill(config.treeRefill, config.treeName);
+    plotter.SetMaxDisplayBins(config.maxDisplayBins);
+    ShardSpec shard;
+    if (!config.shard.empty() && !ParseShard(config.shard, shard)) {
+        std::cerr << "Error: invalid shard \"" << config.shard << "\", expected i/N with 0 <= i < N" << std::endl;
+        return;
+    }
+    RunCatalog catalog = RunCatalog::Load(config.runList, config.dbUrl, config.dbUser, config.dbPassword, config.dbQuery)
+        .Filter(config.minRun, config.maxRun, config.goodOnly);
+    ConfigureRunCache(config.inputDir, config.cacheFile, config.openTimeout, config.openRetries, config.memoryBudgetMB, config.checkStale);
+    if (!config.outputDir.empty()) {
+        plotter.SetOutputDir(config.outputDir);
+    }
+    if (shard.IsSharded()) {
+        PrepareShard(catalog, shard, config.partialDir.empty() ? DefaultShardDir() : config.partialDir);
+        // Shards running side by side would overwrite each other's manifests, so every shard renders its plots anew
+        plotter.SetIncremental(false);
+    }
+    plotter.SetRunCatalog(catalog);
+
+    // Plot all QA histograms in a single pass over the runs
+    plotter.PlotAll(DefaultHistSpecs());
+}
 
-    // Plot various histograms using the Plot method from the SinglePlotter object.
+// Headless entry point for cron/batch jobs: never reads stdin and never opens a graphics window
+// Example: root -l -b -q -e '.L SinglePlotGenerator.cpp' -e 'SinglePlotGeneratorBatch(config)'
+void SinglePlotGeneratorBatch(const SinglePlotConfig& config) {
+    gROOT->SetBatch(kTRUE);
+    RunSinglePlots(config);
+}
 
-    // Chi^2 Plot
-    plotter.Plot(
-        "hClusterChi",                      // Histogram name
-        "Cluster #chi^{2} Distribution",    // Title
-        "Cluster #chi^{2}",                 // X-axis label
-        "Counts"                            // Y-axis label
-    );
+// Headless entry point taking the settings as plain arguments, for use straight from the command line
+// histToCut: names of the histograms to cut, separated by commas or spaces (empty = no energy cut)
+// verbosity: 0 = quiet, 1 = info, 2 = debug; summaryFile: optional JSON-lines plot summary ("-" = standard output)
+// Example: root -l -b -q -e '.L SinglePlotGenerator.cpp' -e 'SinglePlotGeneratorBatch("hClusterPt,hClusterECore", 0.5, 8)'
+void SinglePlotGeneratorBatch(const char* histToCut = "", double cutValue = 0.0, int nThreads = 1, const char* runList = "", bool incremental = false,
+                              int verbosity = 1, const char* summaryFile = "") {
+    SinglePlotConfig config;
+    std::string names(histToCut ? histToCut : "");
+    std::replace(names.begin(), names.end(), ',', ' ');
+    std::stringstream ss(names);
+    std::string name;
+    while (ss >> name) {
+        config.histToCut.push_back(name);
+    }
+    config.applyCut = !config.histToCut.empty();
+    config.cutValue = cutValue;
+    config.nThreads = nThreads;
+    config.runList = runList ? runList : "";
+    config.incremental = incremental;
+    config.logLevel = LogLevelFromInt(verbosity);
+    config.summaryFile = summaryFile ? summaryFile : "";
+    SinglePlotGeneratorBatch(config);
+}
 
-    // MBD Charge Plot
-    plotter.Plot(
-        "hTotalMBD",                   // Histogram name
-        "MBD Charge Distribution",     // Title
-        "MBD Charge",                  // X-axis label
-        "Counts"                       // Y-axis label
-    );
+// Headless batch job of a sharded campaign: plots the runs of shard "i/N" and writes its partial file to partialDir
+// The overlays are made afterwards from all N partial files with OverlayedPlotGeneratorMerge(N, partialDir)
+// partialDir: empty for <inputDir>/qa_shards/, the merge step's default too
+// Example: root -l -b -q -e '.L SinglePlotGenerator.cpp' -e 'SinglePlotGeneratorShard("3/20", "runs.csv", "/shared/partials/", 4)'
+void SinglePlotGeneratorShard(const char* shard, const char* runList = "", const char* partialDir = "", int nThreads = 1, int verbosity = 1) {
+    SinglePlotConfig config;
+    config.shard = shard ? shard : "";
+    config.runList = runList ? runList : "";
+    config.partialDir = partialDir ? partialDir : "";
+    config.nThreads = nThreads;
+    config.logLevel = LogLevelFromInt(verbosity);
+    SinglePlotGeneratorBatch(config);
+}
 
-    // Cluster pT Plot
-    plotter.Plot(
-        "hClusterPt",                          // Histogram name
-        "Cluster p_{T} Good Runs Distribution", // Title
-        "Cluster p_{T} (GeV)",                  // X-axis label
-        "Counts"                                // Y-axis label
-    );
+// Headless cut scan: renders every listed cut value for the histograms in histToCut from one read of each run
+// histToCut and cutValues are separated by commas or spaces; overlay adds one canvas per run with all cut values
+// Example: root -l -b -q -e '.L SinglePlotGenerator.cpp' -e 'SinglePlotGeneratorCutScan("hClusterPt,hClusterECore", "0.5,1,2,3", 8)'
+void SinglePlotGeneratorCutScan(const char* histToCut, const char* cutValues, int nThreads = 1, const char* runList = "", bool overlay = true,
+                                int verbosity = 1) {
+    SinglePlotConfig config;
+    std::string names(histToCut ? histToCut : "");
+    std::replace(names.begin(), names.end(), ',', ' ');
+    std::stringstream ss(names);
+    std::string name;
+    while (ss >> name) {
+        config.histToCut.push_back(name);
+    }
+    std::string values(cutValues ? cutValues : "");
+    std::replace(values.begin(), values.end(), ',', ' ');
+    std::stringstream vs(values);
+    double value;
+    while (vs >> value) {
+        config.cutValues.push_back(value);
+    }
+    config.applyCut = !config.histToCut.empty() && !config.cutValues.empty();
+    config.cutOverlay = overlay;
+    config.nThreads = nThreads;
+    config.runList = runList ? runList : "";
+    config.logLevel = LogLevelFromInt(verbosity);
+    SinglePlotGeneratorBatch(config);
+}
 
-    // Cluster Energy Plot
-    plotter.Plot(
-        "hTotalCaloE",                   // Histogram name
-        "Total Calorimeter Energy Distribution", // Title
-        "Cluster Energy (GeV)",          // X-axis label
-        "Counts"                         // Y-axis label
-    );
+// Interactive entry point: asks for the energy cut settings on the terminal
+// nThreads: worker threads for run processing; runList: optional CSV run catalog (run,sebCount[,good[,color]])
+// incremental: only re-render plots whose qa.root or settings changed since the last invocation
+void SinglePlotGenerator(int nThreads = 1, const char* runList = "", bool incremental = false) {
+    SinglePlotConfig config;
+    config.nThreads = nThreads;
+    config.runList = runList ? runList : "";
+    config.incremental = incremental;
+    
+    // Call AskApplyCut() to determine if an energy cut should be applied.
+    config.applyCut = AskApplyCut();
 
-    // Cluster ECore Plot
-    plotter.Plot(
-        "hClusterECore",               // Histogram name
-        "Cluster ECore Distribution",  // Title
-        "Cluster ECore (GeV)",         // X-axis label
-        "Counts"                       // Y-axis label
-    );
+    // If an energy cut should be applied, get further details.
+    if (config.applyCut) {
+        config.histToCut = AskHistogramToCut(); // Get the list of histograms for the cut.
+        config.cutValue = AskEnergyCutValue();  // Get the energy cut value.
+    }
+    
+    RunSinglePlots(config);
 }
@@ -0,0 +1,368 @@
+// Macro to extract per-run QA metrics and plot their trends versus run number
+
+/*
+   MACRO OVERVIEW:
+   For monitoring, one scalar per run and histogram is usually enough: this macro streams once over the run
+   catalog and reduces every QA histogram of a run to its mean, RMS, normalized integral and normalized
+   integral above the energy cut, plus the tail fraction of hClusterChi above a chi2 threshold.
+   Each run is released from the run cache as soon as its metrics are taken, and a consolidated cache file
+   is read lazily (only the runs' event counts and key lists up front, a run's histograms when it is
+   summarized), so the histograms in memory do not grow with the length of the run list. The metrics are written as one row per run to a TTree ("trend")
+   and optionally a CSV file, and each metric is drawn as a graph versus run number: a handful of plots
+   instead of one image per run and histogram.
+*/
+
+#include <TFile.h>
+#include <TH1F.h>
+#include <TTree.h>
+#include <TGraph.h>
+#include <TCanvas.h>
+#include <TROOT.h>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "QARunCache.h"
+#include "QAHistSpec.h"
+#include "QARunCatalog.h"
+#include "QALogger.h"
+#include "QANormalization.h"
+#include "QAPlotWriter.h"
+#include "QARunFetch.h"
+
+class TrendPlotter {
+public:
+    TrendPlotter() {
+        cTrend_ = new TCanvas("cTrend", "", 1000, 500);
+        cTrend_->SetGrid();
+    }
+
+    ~TrendPlotter() { delete cTrend_; }
+
+    // Set the runs to summarize, walked in run order (defaults to RunCatalog::Default())
+    void SetRunCatalog(const RunCatalog& catalog) {
+        catalog_ = catalog;
+        catalog_.SortByRun();
+    }
+
+    // Directory of the trend plots and of the default output files (with trailing '/')
+    void SetOutputDir(const std::string& outputDir) { outputDir_ = outputDir; }
+
+    // ROOT file holding the "trend" tree, empty for <outputDir>/QA_Trends.root; CSV copy of the table (empty = none)
+    void SetOutputFiles(const std::string& rootFile, const std::string& csvFile = "") {
+        rootFile_ = rootFile;
+        csvFile_ = csvFile;
+    }
+
+    // Lower energy cut of the "integral above cut" metric (GeV) and chi2 above which a cluster counts as tail
+    void SetCuts(double energyCut, double chiTailCut) {
+        energyCut_ = energyCut;
+        chiTailCut_ = chiTailCut;
+    }
+
+    // Normalize the integrals by number of events and SEB count (as the plotters do)
+    void SetNormalize(bool normalize) { normalize_ = normalize; }
+
+    // Image format of the trend plots, or one multi-page PDF (QA_Trends.pdf) holding all of them
+    void SetOutputFormat(const std::string& format, bool multiPage = false) {
+        writer_.SetFormat(format);
+        writer_.SetMultiPage(multiPage);
+    }
+
+    // Draw the trend graphs after the table is written (the table alone is enough for external monitoring)
+    void SetDrawTrends(bool draw) { drawTrends_ = draw; }
+
+    // Read the next run in the background while the current one is summarized
+    void SetPrefetch(bool prefetch) { prefetch_ = prefetch; }
+
+    void SetLogLevel(LogLevel level) { logLevel_ = level; }
+
+    // Write a JSON-lines summary (run, status, nEvents, time) at the end ("-" = standard output)
+    void SetSummaryFile(const std::string& summaryFile) { summaryFile_ = summaryFile; }
+
+    // Stream over the catalog once, writing one row of metrics per run, then draw the trends
+    // Returns the number of runs written to the table
+    int Process(const std::vector<HistSpec>& specs) {
+        BuildColumns(specs);
+        const std::string rootPath = rootFile_.empty() ? outputDir_ + "QA_Trends.root" : rootFile_;
+        TFile* out = TFile::Open(rootPath.c_str(), "RECREATE");
+        if (!out || out->IsZombie()) {
+            std::cout << "Trend issue: cannot write " << rootPath << std::endl;
+            delete out;
+            return 0;
+        }
+
+        // The tree belongs to the output file, which receives its baskets as they fill
+        TTree* tree = new TTree("trend", "Per-run EMCal QA metrics");
+        Int_t runNumber = 0;
+        Int_t sebCount = 0;
+        Double_t nEvents = 0;
+        std::vector<Double_t> values(columns_.size(), 0.0);
+        tree->Branch("run", &runNumber, "run/I");
+        tree->Branch("sebCount", &sebCount, "sebCount/I");
+        tree->Branch("nEvents", &nEvents, "nEvents/D");
+        for (size_t c = 0; c < columns_.size(); c++) {
+            tree->Branch(columns_[c].c_str(), &values[c], (columns_[c] + "/D").c_str());
+        }
+        std::ofstream csv;
+        if (!csvFile_.empty()) {
+            csv.open(csvFile_);
+            csv << "run,sebCount,nEvents";
+            for (const auto& column : columns_) {
+                csv << "," << column;
+            }
+            csv << "\n";
+        }
+
+        if (prefetch_) {
+            ROOT::EnableThreadSafety();
+        }
+        summary_.Clear();
+        trendRuns_.clear();
+        trendValues_.assign(columns_.size(), std::vector<double>());
+        const std::vector<RunInfo>& runs = catalog_.Runs();
+        std::future<bool> prefetch;
+        int nWritten = 0;
+        for (size_t i = 0; i < runs.size(); i++) {
+            const RunInfo& info = runs[i];
+            FinishPrefetch(prefetch, info.run, nullptr);
+            if (prefetch_ && i + 1 < runs.size()) {
+                prefetch = PrefetchRun(runs[i + 1].run);
+            }
+            RunLog log(logLevel_);
+            StageTimer timer;
+            std::string error;
+            std::string status = ExtractRun(info, specs, values, log, error);
+            if (status == "ok") {
+                runNumber = info.id;
+                sebCount = info.sebCount;
+                nEvents = RunHistCache::Instance().GetRun(info.run).nEvents;
+                tree->Fill();
+                if (csv.is_open()) {
+                    csv << info.run << "," << sebCount << "," << (long long)nEvents;
+                    for (double value : values) {
+                        csv << "," << value;
+                    }
+                    csv << "\n";
+                }
+                // Only the scalars are kept for the graphs
+                trendRuns_.push_back(runNumber);
+                for (size_t c = 0; c < values.size(); c++) {
+                    trendValues_[c].push_back(values[c]);
+                }
+                nWritten++;
+            }
+            summary_.Add({info.run, "*", status, RunHistCache::Instance().GetRun(info.run).nEvents, timer.Lap(), error});
+            // Done with this run: its histograms leave the cache
+            RunHistCache::Instance().ReleaseRun(info.run);
+            log.Flush();
+        }
+        out->cd();
+        tree->Write();
+        out->Close();
+        delete out;
+
+        if (logLevel_ >= LogLevel::kInfo) {
+            std::cout << "Wrote metrics of " << nWritten << " of " << runs.size() << " runs to " << rootPath << std::endl;
+        }
+        summary_.PrintFailures();
+        if (!summaryFile_.empty()) {
+            summary_.Write(summaryFile_);
+        }
+        if (drawTrends_) {
+            DrawTrends();
+        }
+        return nWritten;
+    }
+
+private:
+    TCanvas* cTrend_;
+    PlotWriter writer_;                     // Output format of the trend plots
+    RunCatalog catalog_ = RunCatalog::Default();
+    std::string outputDir_ = "/Users/patsfan753/Desktop/QA_EMCal/TrendPlotOutput/";
+    std::string rootFile_;
+    std::string csvFile_;
+    double energyCut_ = 0.0;                // Lower edge of the "integral above cut" metric (GeV)
+    double chiTailCut_ = 10.0;              // hClusterChi tail threshold
+    bool normalize_ = true;
+    bool drawTrends_ = true;
+    bool prefetch_ = false;
+    LogLevel logLevel_ = LogLevel::kInfo;
+    std::string summaryFile_;
+    PlotSummaryLog summary_;
+
+    // Table layout: one column per histogram and metric, named <hist>_<metric>
+    std::vector<std::string> columns_;
+
+    // Run numbers and column values of every written row, for the graphs
+    std::vector<double> trendRuns_;
+    std::vector<std::vector<double>> trendValues_;
+
+    static const char* const* MetricNames() {
+        static const char* const names[] = {"mean", "rms", "integral", "integralAboveCut"};
+        return names;
+    }
+    static const int kNMetrics = 4;
+
+    void BuildColumns(const std::vector<HistSpec>& specs) {
+        columns_.clear();
+        for (const auto& spec : specs) {
+            for (int m = 0; m < kNMetrics; m++) {
+                columns_.push_back(spec.histName + "_" + MetricNames()[m]);
+            }
+            if (spec.histName == "hClusterChi") {
+                columns_.push_back(spec.histName + "_tailFraction");
+            }
+        }
+    }
+
+    // Sum of the bin contents (overflow included, underflow never) of the bins whose centers are at or above low
+    static double IntegralAbove(const TH1F* hist, double low) {
+        double sum = 0;
+        const int nBins = hist->GetNbinsX();
+        for (int bin = 1; bin <= nBins + 1; bin++) {
+            if (bin == nBins + 1 || hist->GetBinCenter(bin) >= low) {
+                sum += hist->GetBinContent(bin);
+            }
+        }
+        return sum;
+    }
+
+    // Fill values (in column order) with the metrics of one run; returns the run's status for the summary
+    // The cached histograms are only read, never copied; they stay in the cache until Process() releases the run
+    std::string ExtractRun(const RunInfo& info, const std::vector<HistSpec>& specs, std::vector<Double_t>& values, RunLog& log,
+                           std::string& error) {
+        log.Info() << "Summarizing run: " << info.run << "\n";
+        const RunHistCache::RunEntry& entry = RunHistCache::Instance().GetRun(info.run);
+        if (!entry.fileOk) {
+            log.Error() << "File issue for run: " << info.run << " (" << entry.error << ")\n";
+            error = entry.error;
+            return "file_error";
+        }
+        if (entry.nEvents < 0) {
+            log.Error() << "Histogram issue for run: " << info.run << "\n";
+            error = "hNClusters not found";
+            return "hist_error";
+        }
+        const double scale = normalize_ ? RunNormalization(entry.nEvents, info.sebCount).scale : 1.0;
+
+        size_t c = 0;
+        for (const auto& spec : specs) {
+            const bool found = RunHistCache::Instance().WithHist(info.run, spec.histName, [&](const TH1F& hist) {
+                const double integral = hist.Integral(0, hist.GetNbinsX() + 1);
+                values[c++] = hist.GetMean();
+                values[c++] = hist.GetRMS();
+                values[c++] = integral * scale;
+                values[c++] = IntegralAbove(&hist, energyCut_) * scale;
+                if (spec.histName == "hClusterChi") {
+                    // Numerator and denominator over the same bins as IntegralAbove: underflow excluded, overflow included
+                    const double inRange = hist.Integral(1, hist.GetNbinsX() + 1);
+                    values[c++] = inRange > 0 ? IntegralAbove(&hist, chiTailCut_) / inRange : 0.0;
+                }
+            });
+            if (!found) {
+                log.Error() << "Histogram issue for run: " << info.run << " (" << spec.histName << ")\n";
+                error = spec.histName + " not found";
+                return "hist_error";
+            }
+        }
+        return "ok";
+    }
+
+    // One graph of every column versus run number
+    void DrawTrends() {
+        const std::string document = outputDir_ + "QA_Trends.pdf";
+        for (size_t c = 0; c < columns_.size(); c++) {
+            if (trendRuns_.empty()) {
+                break;
+            }
+            cTrend_->Clear();
+            TGraph* graph = new TGraph((Int_t)trendRuns_.size(), trendRuns_.data(), trendValues_[c].data());
+            graph->SetTitle((columns_[c] + " vs run").c_str());
+            graph->SetMarkerStyle(20);
+            graph->SetMarkerSize(0.6);
+            graph->GetXaxis()->SetTitle("Run");
+            graph->GetYaxis()->SetTitle(columns_[c].c_str());
+            graph->Draw("AP");
+            cTrend_->Update();
+            writer_.Save(cTrend_, outputDir_ + "Trend_" + columns_[c] + "." + writer_.GetFormat(), document);
+            cTrend_->Clear();
+            delete graph;
+        }
+        writer_.ClosePages(cTrend_);
+        writer_.Flush();
+    }
+};
+
+// Struct to hold every setting of a TrendPlotGenerator pass
+struct TrendPlotConfig {
+    std::string runList;        // Optional CSV run catalog, empty for the default runs
+    int minRun = 0;             // Only runs from this run number on, 0 = no lower limit
+    int maxRun = 0;             // Only runs up to this run number, 0 = no upper limit
+    bool goodOnly = false;      // Only the runs flagged good in the catalog
+    std::string dbUrl;          // Run database (e.g. mysql://host/db) queried instead of runList, empty for none
+    std::string dbUser;         // Run database user
+    std::string dbPassword;     // Run database password
+    std::string dbQuery;        // Query returning run, sebCount and (optionally) a good-run flag
+    std::string inputDir;       // Directory or URL (root://...) holding <run>/qa.root, empty for the default
+    std::string outputDir;      // Directory for the trend plots and default output files, empty for the default
+    std::string rootFile;       // ROOT file with the "trend" tree, empty for <outputDir>/QA_Trends.root
+    std::string csvFile;        // Optional CSV copy of the table
+    double energyCut = 0.0;     // Lower edge of the integral-above-cut metric (GeV)
+    double chiTailCut = 10.0;   // hClusterChi tail threshold
+    bool normalize = true;      // Normalize the integrals by number of events and SEB count
+    bool drawTrends = true;     // Draw one graph per metric versus run number
+    std::string format = "png"; // Image format of the graphs
+    bool multiPagePdf = false;  // All graphs in one QA_Trends.pdf
+    bool prefetch = false;      // Read the next run in the background
+    int openTimeout = 0;        // Seconds before an open of a (remote) qa.root gives up, 0 = no timeout
+    int openRetries = 0;        // Extra attempts at opening a qa.root that failed to open
+    double memoryBudgetMB = 0;  // Memory cap of the histogram cache in MB (least recently used evicted first), 0 = unlimited
+    std::string cacheFile;      // Consolidated cache file, empty for <inputDir>/qa_consolidated.root if present
+    bool checkStale = false;    // Read runs reprocessed since the consolidation from qa.root (one stat per run)
+    LogLevel logLevel = LogLevel::kInfo;    // Console verbosity
+    std::string summaryFile;    // Optional JSON-lines run summary ("-" = standard output)
+};
+
+// Extract the trend table and plots with the given settings
+void RunTrendPlots(const TrendPlotConfig& config) {
+    TrendPlotter plotter;
+    plotter.SetRunCatalog(RunCatalog::Load(config.runList, config.dbUrl, config.dbUser, config.dbPassword, config.dbQuery)
+                              .Filter(config.minRun, config.maxRun, config.goodOnly));
+    ConfigureRunCache(config.inputDir, config.cacheFile, config.openTimeout, config.openRetries, config.memoryBudgetMB, config.checkStale);
+    // Runs are visited once, so a consolidated file must not bring every run's histograms in up front
+    RunHistCache::Instance().SetLazyLoading(true);
+    if (!config.outputDir.empty()) {
+        plotter.SetOutputDir(config.outputDir);
+    }
+    plotter.SetOutputFiles(config.rootFile, config.csvFile);
+    plotter.SetCuts(config.energyCut, config.chiTailCut);
+    plotter.SetNormalize(config.normalize);
+    plotter.SetDrawTrends(config.drawTrends);
+    plotter.SetOutputFormat(config.format, config.multiPagePdf);
+    plotter.SetPrefetch(config.prefetch);
+    plotter.SetLogLevel(config.logLevel);
+    plotter.SetSummaryFile(config.summaryFile);
+    plotter.Process(DefaultHistSpecs());
+}
+
+// Headless entry point for cron/batch jobs
+// Example: root -l -b -q -e '.L TrendPlotGenerator.cpp' -e 'TrendPlotGeneratorBatch("runs.csv", 0.5, "trends.csv")'
+void TrendPlotGeneratorBatch(const char* runList = "", double energyCut = 0.0, const char* csvFile = "", int verbosity = 1) {
+    gROOT->SetBatch(kTRUE);
+    TrendPlotConfig config;
+    config.runList = runList ? runList : "";
+    config.energyCut = energyCut;
+    config.csvFile = csvFile ? csvFile : "";
+    config.logLevel = LogLevelFromInt(verbosity);
+    RunTrendPlots(config);
+}
+
+// Interactive entry point with the default settings
+void TrendPlotGenerator(const char* runList = "") {
+    TrendPlotConfig config;
+    config.runList = runList ? runList : "";
+    RunTrendPlots(config);
+}
@@ -0,0 +1,123 @@
+// Macro to plot new runs as their qa.root files appear, for the EMCal QA plotting macros
+
+/*
+   MACRO OVERVIEW:
+   A long-running session that polls the input directory (see QAWatch.h) and, for every run whose qa.root
+   has completed, makes the run's single-run plots and adds its curve to the overlays. The libraries, the
+   run cache and the comparison references stay loaded between polls, so each new run costs one file read:
+   the single plots run in incremental mode (plots already up to date on disk are skipped, also after a
+   restart) and the overlays keep the normalized curves of the latest maxLiveRuns earlier runs on their
+   canvases instead of reading and drawing them again.
+   The runs already present when the watch starts are handled on the first poll.
+
+   Usage: root -l -b -q 'WatchQA.cpp+O("runs.csv", 60, 8)'
+*/
+
+#include "SinglePlotGenerator.cpp"
+#include "OverlayedPlotGenerator.cpp"
+#include "QAWatch.h"
+#include <TSystem.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Struct to hold every setting of a watch session
+struct WatchConfig {
+    std::string runList;        // CSV run catalog with the SEB counts of new runs, re-read whenever it changes
+    std::string inputDir;       // Directory holding <run>/qa.root, empty for the default
+    std::string singleOutputDir;    // Output directory of the single-run plots, empty for the default
+    std::string overlayOutputDir;   // Output directory of the overlays, empty for the default
+    int pollSeconds = 60;       // Seconds between two looks at the input directory
+    int settleSeconds = 60;     // Seconds a qa.root must stay unmodified before its run is plotted
+    int maxPolls = 0;           // Stop after this many polls, 0 = run until the job is killed
+    bool normalize = true;      // Normalize by number of events and SEB count
+    int nThreads = 1;           // Worker threads of the single-run plots (0 = one per core)
+    bool compare = false;       // Score each new run against the reference of the first runs and report the outliers
+    std::string comparisonCsv;  // Optional CSV with the scores, rewritten after every poll with new runs
+    double memoryBudgetMB = 0;  // Memory cap of the histogram cache in MB, 0 = unlimited
+    int maxDisplayBins = 0;     // Most bins drawn per plot and overlay curve (merged for display only), 0 = every bin
+    unsigned maxLiveRuns = 50;  // Curves of the latest runs kept on each overlay, 0 = every run of the session
+    LogLevel logLevel = LogLevel::kInfo;    // Console verbosity
+};
+
+// Poll the input directory and plot every new run until maxPolls is reached
+void RunWatch(const WatchConfig& config) {
+    gROOT->SetBatch(kTRUE);
+    ConfigureRunCache(config.inputDir, "", 0, 0, config.memoryBudgetMB);
+    // A consolidated file only holds runs that existed when it was written
+    RunHistCache::Instance().SetConsolidatedFile("none");
+    const std::vector<HistSpec> specs = DefaultHistSpecs();
+    
+    SinglePlotter single(config.normalize);
+    single.SetIncremental(true);
+    single.SetNThreads(config.nThreads);
+    single.SetLogLevel(config.logLevel);
+    single.SetMaxDisplayBins(config.maxDisplayBins);
+    if (!config.singleOutputDir.empty()) {
+        single.SetOutputDir(config.singleOutputDir);
+    }
+    
+    OverlayPlotter overlay(config.normalize);
+    overlay.SetRunCatalog(RunCatalog());
+    overlay.SetComparison(config.compare);
+    overlay.SetComparisonFile(config.comparisonCsv);
+    overlay.SetLogLevel(config.logLevel);
+    overlay.SetMaxDisplayBins(config.maxDisplayBins);
+    overlay.SetMaxLiveRuns(config.maxLiveRuns);
+    if (!config.overlayOutputDir.empty()) {
+        overlay.SetOutputDir(config.overlayOutputDir);
+    }
+    
+    RunWatcher watcher(config.runList);
+    watcher.SetSettleTime(config.settleSeconds);
+    if (config.logLevel >= LogLevel::kInfo) {
+        std::cout << "Watching " << RunHistCache::Instance().GetBaseDir() << " every " << config.pollSeconds << " s\n";
+    }
+    for (int poll = 0; config.maxPolls == 0 || poll < config.maxPolls; poll++) {
+        if (poll > 0) {
+            gSystem->Sleep(config.pollSeconds * 1000);
+        }
+        const std::vector<RunInfo> runs = watcher.Poll();
+        if (runs.empty()) {
+            continue;
+        }
+        if (config.logLevel >= LogLevel::kInfo) {
+            std::cout << "New runs:";
+            for (const auto& info : runs) {
+                std::cout << " " << info.run;
+            }
+            std::cout << "\n";
+        }
+        RunCatalog batch;
+        for (const auto& info : runs) {
+            batch.Add(info);
+        }
+        single.SetRunCatalog(batch);
+        single.PlotAll(specs);
+        overlay.AppendRuns(runs, specs);
+        
+        // The overlays hold their own copies and the references their own sums, so the runs can leave the cache
+        for (const auto& info : runs) {
+            RunHistCache::Instance().ReleaseRun(info.run);
+        }
+        if (config.logLevel >= LogLevel::kInfo) {
+            std::cout << "Plotted " << runs.size() << " new runs (" << watcher.NProcessed() << " this session)\n" << std::flush;
+        }
+    }
+}
+
+// Watch the input directory and plot new runs as they complete
+// pollSeconds: time between polls; maxPolls: 0 = run forever; verbosity: 0 = quiet, 1 = info, 2 = debug
+// Example: root -l -b -q 'WatchQA.cpp+O("runs.csv", 60, 8, true)'
+void WatchQA(const char* runList = "", int pollSeconds = 60, int nThreads = 1, bool compare = false, int maxPolls = 0, int verbosity = 1,
+             const char* inputDir = "") {
+    WatchConfig config;
+    config.runList = runList ? runList : "";
+    config.pollSeconds = pollSeconds;
+    config.nThreads = nThreads;
+    config.compare = compare;
+    config.maxPolls = maxPolls;
+    config.logLevel = LogLevelFromInt(verbosity);
+    config.inputDir = inputDir ? inputDir : "";
+    RunWatch(config);
+}
@@ -0,0 +1,244 @@
+// Macro to benchmark the full SinglePlotter and OverlayPlotter flows on synthetic qa.root fixtures
+
+/*
+   MACRO OVERVIEW:
+   Runs SinglePlotter::PlotAll and OverlayPlotter::OverlayAll over the runs written by MakeSyntheticQA and
+   reports, for each flow, the wall time, throughput in runs/s, milliseconds per image and the peak resident
+   memory of the flow. Every flow runs in its own forked process, so it starts from a cold histogram cache
+   (including the reading of its input files) and its peak memory is its own rather than the highest peak of
+   the flows before it. Processes forked by a flow itself (overlay workers) are not included in the peak.
+   After each flow the benchmark checks its output: the number of images written during the flow and the
+   number of "ok" rows in its JSON-lines summary must match the runs and histograms it was given, so a
+   change that gets faster by dropping plots shows up as FAIL instead of as a speed-up.
+   Results can be appended to a CSV file to keep a baseline across changes.
+
+   Usage:
+       root -l -b -q 'MakeSyntheticQA.cpp("bench_input/", 100, 1000)'
+       root -l -b -q 'BenchmarkPlotters.cpp("bench_input/", "bench_output/", 1, 1, "bench_results.csv")'
+*/
+
+#include "../SinglePlotGenerator.cpp"
+#include "../OverlayedPlotGenerator.cpp"
+#include <TSystem.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+// Struct to hold the measurements of one benchmarked flow
+struct BenchResult {
+    std::string flow;   // Name of the flow
+    size_t nRuns;       // Runs processed
+    size_t nImages;     // Images written
+    double seconds;     // Wall time
+    double peakRSSMB;   // Peak resident memory of the process that ran the flow
+    size_t nRows = 0;   // Summary rows expected with status ok
+    bool passed = false;    // Whether the images and summary rows found match nImages and nRows
+};
+
+// Number of files ending in ext in dir and its direct subdirectories that were modified at or after since
+size_t CountNewFiles(const std::string& dir, const std::string& ext, long since) {
+    size_t count = 0;
+    void *handle = gSystem->OpenDirectory(dir.c_str());
+    if (!handle) {
+        return 0;
+    }
+    while (const char *entry = gSystem->GetDirEntry(handle)) {
+        const std::string name(entry);
+        if (name == "." || name == "..") {
+            continue;
+        }
+        const std::string path = dir + name;
+        FileStat_t stat;
+        if (gSystem->GetPathInfo(path.c_str(), stat) != 0) {
+            continue;
+        }
+        if (R_ISDIR(stat.fMode)) {
+            count += CountNewFiles(path + "/", ext, since);
+        } else if (name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0 && stat.fMtime >= since) {
+            count++;
+        }
+    }
+    gSystem->FreeDirectory(handle);
+    return count;
+}
+
+// Number of rows of a JSON-lines plot summary with status ok
+size_t CountOkRows(const std::string& path) {
+    std::ifstream in(path);
+    std::string line;
+    size_t count = 0;
+    while (std::getline(in, line)) {
+        if (line.find("\"status\":\"ok\"") != std::string::npos) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Check a finished flow against what it should have produced (images under dir, rows in its summary), reporting any mismatch
+void CheckFlow(BenchResult& result, const std::string& dir, const std::string& summaryPath, long since) {
+    const size_t nImages = CountNewFiles(dir, ".png", since);
+    const size_t nRows = CountOkRows(summaryPath);
+    result.passed = result.seconds >= 0 && nImages == result.nImages && nRows == result.nRows;
+    if (!result.passed) {
+        std::cout << "Benchmark check failed for " << result.flow << ": " << nImages << " of " << result.nImages << " images, " << nRows
+                  << " of " << result.nRows << " ok summary rows" << std::endl;
+    }
+}
+
+// Peak resident set size recorded in usage, in MB
+double PeakRSSMB(const struct rusage& usage) {
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);   // bytes on macOS
+#else
+    return usage.ru_maxrss / 1024.0;              // kilobytes on Linux
+#endif
+}
+
+// Time one flow in a forked child process and collect its result
+// The child sends its wall time back through a pipe; wait4 returns the resource usage of that child alone
+template <typename Flow>
+BenchResult TimeFlow(const std::string& name, size_t nRuns, size_t nImages, Flow flow) {
+    RunHistCache::Instance().Clear();
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cout << "Benchmark issue: cannot create a pipe for " << name << std::endl;
+        return {name, nRuns, nImages, -1, -1};
+    }
+    std::cout << std::flush;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        auto start = std::chrono::steady_clock::now();
+        flow();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ssize_t written = write(fds[1], &seconds, sizeof(seconds));
+        close(fds[1]);
+        std::cout << std::flush;
+        _exit(written == (ssize_t)sizeof(seconds) ? 0 : 1);
+    }
+    close(fds[1]);
+    double seconds = -1;
+    if (pid < 0 || read(fds[0], &seconds, sizeof(seconds)) != (ssize_t)sizeof(seconds)) {
+        std::cout << "Benchmark issue: flow " << name << " did not report a result" << std::endl;
+        seconds = -1;
+    }
+    close(fds[0]);
+    struct rusage usage = {};
+    int status = 0;
+    if (pid > 0) {
+        wait4(pid, &status, 0, &usage);
+    }
+    return {name, nRuns, nImages, seconds, pid > 0 ? PeakRSSMB(usage) : -1};
+}
+
+void BenchmarkPlotters(const char* inputDir = "bench_input/", const char* outputDir = "bench_output/", int nThreads = 1, int nProcesses = 1,
+                       const char* resultFile = "") {
+    gROOT->SetBatch(kTRUE);
+    
+    std::string input(inputDir);
+    std::string output(outputDir);
+    if (!input.empty() && input.back() != '/') input += '/';
+    if (!output.empty() && output.back() != '/') output += '/';
+    
+    RunCatalog catalog = RunCatalog::FromCSV(input + "runs.csv");
+    if (catalog.Size() == 0) {
+        std::cout << "No runs found in " << input << "runs.csv; generate them with MakeSyntheticQA.cpp first" << std::endl;
+        return;
+    }
+    RunHistCache::Instance().SetBaseDir(input);
+    const std::vector<HistSpec> specs = DefaultHistSpecs();
+    
+    // The plotters expect their output folders to exist
+    const std::string singleDir = output + "single/";
+    const std::string overlayDir = output + "overlay/";
+    for (const char* sub : {"Cluster_Chi/", "Cluster_pt/", "ECore/", "Total_Calo_Energy/", "MBD_charge/"}) {
+        gSystem->mkdir((singleDir + sub).c_str(), kTRUE);
+    }
+    gSystem->mkdir(overlayDir.c_str(), kTRUE);
+    
+    std::vector<BenchResult> results;
+    // Every flow writes one ok summary row per run and histogram
+    const size_t nRows = catalog.Size() * specs.size();
+    
+    // Flow 1: one image per run and histogram
+    std::string summary = output + "SinglePlotter_summary.jsonl";
+    gSystem->Unlink(summary.c_str());
+    long since = (long)std::time(nullptr);
+    results.push_back(TimeFlow("SinglePlotter", catalog.Size(), catalog.Size() * specs.size(), [&]() {
+        SinglePlotter plotter(true);
+        plotter.SetRunCatalog(catalog);
+        plotter.SetOutputDir(singleDir);
+        plotter.SetNThreads(nThreads);
+        plotter.SetLogLevel(LogLevel::kQuiet);
+        plotter.SetSummaryFile(summary);
+        plotter.PlotAll(specs);
+    }));
+    results.back().nRows = nRows;
+    CheckFlow(results.back(), singleDir, summary, since);
+    
+    // Flow 1b: the same with the next run read in the background while the current one renders
+    summary = output + "SinglePrefetch_summary.jsonl";
+    gSystem->Unlink(summary.c_str());
+    since = (long)std::time(nullptr);
+    results.push_back(TimeFlow("SinglePrefetch", catalog.Size(), catalog.Size() * specs.size(), [&]() {
+        SinglePlotter plotter(true);
+        plotter.SetRunCatalog(catalog);
+        plotter.SetOutputDir(singleDir);
+        plotter.SetNThreads(nThreads);
+        plotter.SetPrefetch(true);
+        plotter.SetLogLevel(LogLevel::kQuiet);
+        plotter.SetSummaryFile(summary);
+        plotter.PlotAll(specs);
+    }));
+    results.back().nRows = nRows;
+    CheckFlow(results.back(), singleDir, summary, since);
+    
+    // Flow 2: one overlay of all runs per histogram
+    summary = output + "OverlayPlotter_summary.jsonl";
+    gSystem->Unlink(summary.c_str());
+    since = (long)std::time(nullptr);
+    results.push_back(TimeFlow("OverlayPlotter", catalog.Size(), specs.size(), [&]() {
+        OverlayPlotter plotter(true);
+        plotter.SetRunCatalog(catalog);
+        plotter.SetOutputDir(overlayDir);
+        plotter.SetNProcesses(nProcesses);
+        plotter.SetLogLevel(LogLevel::kQuiet);
+        plotter.SetSummaryFile(summary);
+        plotter.OverlayAll(specs);
+    }));
+    results.back().nRows = nRows;
+    CheckFlow(results.back(), overlayDir, summary, since);
+    
+    // Results table
+    std::cout << "=================== Benchmark results ===================\n";
+    std::cout << std::left << std::setw(16) << "flow" << std::right << std::setw(7) << "runs" << std::setw(8) << "images"
+              << std::setw(10) << "wall [s]" << std::setw(10) << "runs/s" << std::setw(12) << "ms/image" << std::setw(14) << "peak RSS [MB]"
+              << std::setw(7) << "check" << "\n";
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(16) << r.flow << std::right << std::setw(7) << r.nRuns << std::setw(8) << r.nImages
+                  << std::fixed << std::setprecision(2) << std::setw(10) << r.seconds << std::setw(10) << r.nRuns / r.seconds
+                  << std::setw(12) << 1000.0 * r.seconds / r.nImages << std::setw(14) << r.peakRSSMB << std::setw(7) << (r.passed ? "ok" : "FAIL")
+                  << "\n";
+    }
+    std::cout << std::flush;
+    
+    // Append to the baseline file, writing the header when the file is new
+    if (resultFile && *resultFile) {
+        bool newFile = gSystem->AccessPathName(resultFile);
+        std::ofstream out(resultFile, std::ios::app);
+        if (newFile) {
+            out << "flow,runs,images,threads,processes,wall_s,runs_per_s,ms_per_image,peak_rss_mb\n";
+        }
+        for (const auto& r : results) {
+            out << r.flow << "," << r.nRuns << "," << r.nImages << "," << nThreads << "," << nProcesses << "," << r.seconds << ","
+                << r.nRuns / r.seconds << "," << 1000.0 * r.seconds / r.nImages << "," << r.peakRSSMB << "\n";
+        }
+    }
+}
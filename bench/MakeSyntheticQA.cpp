@@ -0,0 +1,104 @@
+// Macro to generate synthetic qa.root fixtures for benchmarking the EMCal QA plotting macros
+
+/*
+   MACRO OVERVIEW:
+   Writes <outDir>/<run>/qa.root for nRuns consecutive run numbers, each holding the histograms read by
+   SinglePlotter and OverlayPlotter (hClusterChi, hClusterPt, hClusterECore, hTotalCaloE, hTotalMBD)
+   with nBins bins, plus an hNClusters histogram whose entry count is the run's number of events.
+   With nTreeClusters > 0 every file also gets a clusterTree with that many entries (one per cluster,
+   float branches clusterPt and clusterECore) for the tree refill mode of SinglePlotter.
+   A matching run catalog is written to <outDir>/runs.csv. The output is fully determined by the
+   arguments, so repeated benchmarks see identical inputs.
+
+   Usage: root -l -b -q 'MakeSyntheticQA.cpp("bench_input/", 100, 1000)'
+*/
+
+#include <TFile.h>
+#include <TH1F.h>
+#include <TRandom3.h>
+#include <TSystem.h>
+#include <TTree.h>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Struct to describe the shape of one synthetic QA histogram
+struct SyntheticShape {
+    const char* name;   // Histogram name in qa.root
+    double xMin;        // Lower edge of the axis
+    double xMax;        // Upper edge of the axis
+    double peak;        // Expected counts in the first bin
+    double slope;       // Exponential fall-off length, in axis units
+};
+
+void MakeSyntheticQA(const char* outDir = "bench_input/", int nRuns = 14, int nBins = 1000, int firstRun = 30000, int nEvents = 100000,
+                     int nTreeClusters = 0) {
+    std::string dir(outDir);
+    if (!dir.empty() && dir.back() != '/') {
+        dir += '/';
+    }
+    
+    const SyntheticShape shapes[] = {
+        {"hClusterChi", 0, 100, 1e5, 10},
+        {"hClusterPt", 0, 20, 1e6, 1.5},
+        {"hClusterECore", 0, 20, 1e6, 2},
+        {"hTotalCaloE", 0, 100, 1e4, 25},
+        {"hTotalMBD", 0, 2000, 1e4, 400}
+    };
+    
+    TRandom3 rng(12345);
+    gSystem->mkdir(dir.c_str(), kTRUE);
+    std::ofstream catalog(dir + "runs.csv");
+    catalog << "run,sebCount,good\n";
+    
+    for (int i = 0; i < nRuns; i++) {
+        const std::string run = std::to_string(firstRun + i);
+        const std::string runDir = dir + run + "/";
+        gSystem->mkdir(runDir.c_str(), kTRUE);
+        
+        TFile file((runDir + "qa.root").c_str(), "RECREATE");
+        
+        // Falling spectra with Poisson fluctuations, filled bin by bin so large bin counts stay cheap
+        for (const auto& shape : shapes) {
+            TH1F hist(shape.name, shape.name, nBins, shape.xMin, shape.xMax);
+            for (int bin = 1; bin <= nBins; bin++) {
+                double mean = shape.peak * std::exp(-(hist.GetBinCenter(bin) - shape.xMin) / shape.slope);
+                hist.SetBinContent(bin, rng.Poisson(mean));
+            }
+            hist.SetEntries(hist.Integral());
+            hist.Write();
+        }
+        
+        // hNClusters is filled once per event, so only its entry count matters to the plotters
+        // (scoped so it is gone before the file is closed, which would otherwise delete it a second time)
+        {
+            TH1F hNClusters("hNClusters", "hNClusters", 100, 0, 100);
+            for (int bin = 1; bin <= 100; bin++) {
+                hNClusters.SetBinContent(bin, rng.Poisson(nEvents * 0.01));
+            }
+            hNClusters.SetEntries(nEvents);
+            hNClusters.Write();
+        }
+        
+        // Per-cluster tree with the same falling shapes as hClusterPt and hClusterECore
+        if (nTreeClusters > 0) {
+            TTree *tree = new TTree("clusterTree", "clusterTree");
+            float clusterPt = 0, clusterECore = 0;
+            tree->Branch("clusterPt", &clusterPt, "clusterPt/F");
+            tree->Branch("clusterECore", &clusterECore, "clusterECore/F");
+            for (int c = 0; c < nTreeClusters; c++) {
+                clusterPt = rng.Exp(1.5);
+                clusterECore = rng.Exp(2);
+                tree->Fill();
+            }
+            // The file owns the tree and deletes it on Close()
+            tree->Write();
+        }
+        file.Close();
+        
+        catalog << run << "," << 5 + i % 4 << ",1\n";
+    }
+    
+    std::cout << "Wrote " << nRuns << " synthetic runs with " << nBins << " bins to " << dir << std::endl;
+}